@@ -0,0 +1,13 @@
+#version 330
+
+uniform sampler2D screen_texture;
+
+in vec2 texcoord;
+
+layout(location = 0) out vec4 color;
+
+// copies a full-screen texture, e.g., the cached static layer
+void main()
+{
+	color = texture(screen_texture, texcoord);
+}
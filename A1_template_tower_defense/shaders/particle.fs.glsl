@@ -1,8 +1,7 @@
 #version 330
 
 // input from vertex
-
-uniform vec4 color;
+in vec4 frag_color;
 
 layout(location = 0) out vec4 out_color;
 
@@ -10,5 +9,6 @@ void main()
 {
     float dist = length(gl_PointCoord - vec2(0.5));
     if (dist > 0.5) discard; // circle
-    out_color = color; 
-}
\ No newline at end of file
+    if (frag_color.a <= 0.0) discard; // dead, left behind on the GPU
+    out_color = frag_color; 
+}
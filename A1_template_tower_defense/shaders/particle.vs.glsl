@@ -1,10 +1,10 @@
 #version 330
 
-// input
+// input, one point per particle
 in vec3 in_position;
+in vec4 in_color;
 
 // uniform data
-uniform mat3 transform;
 uniform mat3 projection;
 uniform float point_size;
 
@@ -12,8 +12,8 @@ out vec4 frag_color;
 
 void main()
 {
-    vec3 pos = projection * transform * vec3(in_position.xy, 1.0);
+    vec3 pos = projection * vec3(in_position.xy, 1.0);
     gl_Position = vec4(pos.xy, in_position.z, 1.0);
     gl_PointSize = point_size;
-
-}
\ No newline at end of file
+    frag_color = in_color;
+}
@@ -0,0 +1,10 @@
+#version 330
+
+// the particle update is only captured by transform feedback, nothing is rasterized
+
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+	out_color = vec4(0);
+}
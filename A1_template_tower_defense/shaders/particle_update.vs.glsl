@@ -0,0 +1,22 @@
+#version 330
+
+// input, one point per particle (GpuParticle)
+in vec3 in_position;
+in vec4 in_color;
+in vec2 in_velocity;
+
+// seconds to advance
+uniform float elapsed;
+
+// captured by transform feedback, in the order of GpuParticle
+out vec2 out_position;
+out vec4 out_color;
+out vec2 out_velocity;
+
+void main()
+{
+	out_position = in_position.xy + in_velocity * elapsed;
+	// particles fade out over their lifespan
+	out_color = vec4(in_color.rgb, in_color.a - elapsed);
+	out_velocity = in_velocity;
+}
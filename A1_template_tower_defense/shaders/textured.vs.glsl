@@ -5,15 +5,16 @@ in vec3 in_position;
 in vec2 in_texcoord;
 
 // Passed to fragment shader
-out vec2 texcoord;
+out vec3 texcoord;
 
 // Application data
 uniform mat3 transform;
 uniform mat3 projection;
+uniform vec3 layer;	// xy: the part of the texture array layer covered by the texture, z: the layer
 
 void main()
 {
-	texcoord = in_texcoord;
+	texcoord = vec3(in_texcoord * layer.xy, layer.z);
 	vec3 pos = projection * transform * vec3(in_position.xy, 1.0);
 	gl_Position = vec4(pos.xy, in_position.z, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330
+
+// From vertex shader
+in vec3 texcoord;
+in vec3 color;
+
+// Application data
+uniform sampler2DArray sampler0;
+
+// Output color
+layout(location = 0) out  vec4 out_color;
+
+void main()
+{
+	out_color = vec4(color, 1.0) * texture(sampler0, texcoord);
+}
@@ -0,0 +1,25 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec2 in_texcoord;
+
+// Per-instance attributes
+in mat3 in_transform;
+in vec3 in_instance_color;
+in vec3 in_instance_layer;	// xy: the part of the layer covered by the texture, z: the layer
+
+// Passed to fragment shader
+out vec3 texcoord;
+out vec3 color;
+
+// Application data
+uniform mat3 projection;
+
+void main()
+{
+	texcoord = vec3(in_texcoord * in_instance_layer.xy, in_instance_layer.z);
+	color = in_instance_color;
+	vec3 pos = projection * in_transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
@@ -1,37 +1,234 @@
 #include <iostream>
+#include <chrono>
 #include "ai_system.hpp"
 #include "world_init.hpp"
 
-void AISystem::step(float elapsed_ms)
+using Clock = std::chrono::high_resolution_clock;
+
+// Behavior tree leaves, referred to by name from the files in data/behaviors
+namespace {
+	// towers count their shot timer down by the time simulated in this update
+	BT_STATUS tower_cooldown(BTContext&, unsigned int agent)
+	{
+		Tower& tower = registry.towers.get(registry.aiAgents.entities[agent]);
+		tower.timer_ms -= registry.aiAgents.components[agent].step_ms;
+		return BT_STATUS::SUCCESS;
+	}
+
+	BT_STATUS tower_timer_ready(BTContext&, unsigned int agent)
+	{
+		const Tower& tower = registry.towers.get(registry.aiAgents.entities[agent]);
+		return tower.timer_ms <= 0 ? BT_STATUS::SUCCESS : BT_STATUS::FAILURE;
+	}
+
+	BT_STATUS invader_in_lane(BTContext& context, unsigned int agent)
+	{
+		const Motion& motion = registry.motions.get(registry.aiAgents.entities[agent]);
+		return context.lane_front_x[BTContext::lane_of(motion.position.y)] >= 0.f ? BT_STATUS::SUCCESS : BT_STATUS::FAILURE;
+	}
+
+	// shoot a projectile and reset the shot timer
+	BT_STATUS tower_shoot(BTContext& context, unsigned int agent)
+	{
+		Entity entity = registry.aiAgents.entities[agent];
+		context.shots.push_back(registry.motions.get(entity).position);
+		registry.towers.get(entity).timer_ms = TOWER_TIMER_MS;
+		return BT_STATUS::SUCCESS;
+	}
+
+	// walk at the speed of the invader's type, halted invaders (e.g. on game over) stay halted
+	BT_STATUS invader_advance(BTContext&, unsigned int agent)
+	{
+		Entity entity = registry.aiAgents.entities[agent];
+		Motion& motion = registry.motions.get(entity);
+		if (motion.velocity.x != 0.f)
+			motion.velocity.x = registry.invaders.get(entity).type == 0 ? INVADER_SPEED_BLUE : INVADER_SPEED_GREEN;
+		return BT_STATUS::SUCCESS;
+	}
+
+	const std::vector<BTLeaf> leaves = {
+		{ "cooldown", tower_cooldown },
+		{ "timer_ready", tower_timer_ready },
+		{ "invader_in_lane", invader_in_lane },
+		{ "shoot", tower_shoot },
+		{ "advance", invader_advance }
+	};
+}
+
+int BTContext::lane_of(float y)
+{
+	int lane = (int)(y / GRID_CELL_HEIGHT_PX);
+	return std::max(0, std::min(lane, GRID_ROWS - 1));
+}
+
+bool AISystem::init()
 {
+	bool all_loaded = true;
+	for (uint i = 0; i < tree_paths.size(); i++)
+		all_loaded &= trees[i].load(tree_paths[i], leaves);
+	return all_loaded;
+}
 
-	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	// !!! TODO A1: scan for invaders and shoot at them
-	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	// invader detection system for towers
-	// - for each tower, scan its row:
-	//   - if an invader is detected and the tower's shooting timer has expired,
-	//     then shoot (create a projectile) and reset the tower's shot timer
+void AISystem::build_lanes()
+{
+	context.lane_front_x.assign(GRID_ROWS, -1.f);
+	context.lane_tower_x.assign(GRID_ROWS, -1.f);
+	lane_agents.resize(GRID_ROWS);
+	for (std::vector<LaneAgent>& agents : lane_agents)
+		agents.clear();
+
+	for (const Entity& invader_entity : registry.invaders.entities) {
+		const Motion& invader_motion = registry.motions.get(invader_entity);
+		int lane = BTContext::lane_of(invader_motion.position.y);
+		float& front_x = context.lane_front_x[lane];
+		front_x = std::max(front_x, invader_motion.position.x);
+		lane_agents[lane].push_back({ invader_motion.position.x, invader_entity });
+	}
 	for (const Entity& tower_entity : registry.towers.entities) {
-		Tower& tower = registry.towers.get(tower_entity);
-		Motion& tower_motion = registry.motions.get(tower_entity);
+		const Motion& tower_motion = registry.motions.get(tower_entity);
+		int lane = BTContext::lane_of(tower_motion.position.y);
+		float& tower_x = context.lane_tower_x[lane];
+		tower_x = tower_x < 0.f ? tower_motion.position.x : std::min(tower_x, tower_motion.position.x);
+		lane_agents[lane].push_back({ tower_motion.position.x, tower_entity });
+	}
+}
+
+void AISystem::queue_boosted()
+{
+	// a lane is engaged once its front invader is close to a tower, the agents around that front are boosted
+	// only the engaged lanes are walked, agents that are still queued from an earlier frame are not added again
+	for (int lane = 0; lane < GRID_ROWS; lane++) {
+		float front_x = context.lane_front_x[lane];
+		float tower_x = context.lane_tower_x[lane];
+		if (front_x < 0.f || tower_x < 0.f || tower_x - front_x >= AI_BOOST_DISTANCE_PX)
+			continue;
+
+		for (const LaneAgent& lane_agent : lane_agents[lane]) {
+			if (lane_agent.x < front_x - AI_BOOST_DISTANCE_PX || !registry.aiAgents.has(lane_agent.entity))
+				continue;
+			AIAgent& agent = registry.aiAgents.get(lane_agent.entity);
+			if (agent.boost_queued)
+				continue;
+			agent.boost_queued = true;
+			boosted_queue.push_back(lane_agent.entity);
+		}
+	}
+}
+
+void AISystem::select(unsigned int agent_index)
+{
+	AIAgent& agent = registry.aiAgents.components[agent_index];
+	if (agent.tree == BEHAVIOR_TREE_ID::BEHAVIOR_TREE_COUNT)
+		return;
+
+	// simulate whole milliseconds only, the fraction stays pending
+	agent.updated_frame = frame;
+	agent.step_ms = (int)agent.pending_ms;
+	agent.pending_ms -= (float)agent.step_ms;
+	batches[(int)agent.tree].push_back(agent_index);
+}
+
+void AISystem::flush()
+{
+	// evaluate each tree once over all of its selected agents
+	for (uint i = 0; i < trees.size(); i++) {
+		trees[i].tick(context, batches[i].data(), batches[i].size());
+		batches[i].clear();
+	}
+
+}
+
+void AISystem::spawn_shots()
+{
+	// create the requested projectiles now that no tree is walking the registry
+	createProjectiles(
+		context.shots.data(),
+		context.shots.size(),
+		{GRID_CELL_WIDTH_PX / 6, GRID_CELL_HEIGHT_PX / 6},
+		{ -GRID_CELL_WIDTH_PX * 5, 0.f}
+	);
+	context.shots.clear();
+}
 
-		tower.timer_ms -= ((int)elapsed_ms);
-		if (tower.timer_ms > 0) continue;
+void AISystem::step(float elapsed_ms)
+{
+	auto t0 = Clock::now();
+	auto elapsed_us = [&t0]() {
+		return (int)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count();
+	};
 
-		for (const Entity& invader_entity : registry.invaders.entities) {
-			Motion& invader_motion = registry.motions.get(invader_entity);
+	frame++;
+	build_lanes();
+	queue_boosted();
 
-			if (abs(invader_motion.position.y - tower_motion.position.y) < INVADER_BB_HEIGHT / 2) {
-				createProjectile(
-					tower_motion.position,
-					{GRID_CELL_WIDTH_PX / 6, GRID_CELL_HEIGHT_PX / 6},
-					{ -GRID_CELL_WIDTH_PX * 5, 0.f}
-				);
+	auto& agent_container = registry.aiAgents;
+	const unsigned int num_agents = (unsigned int)agent_container.size();
 
-				tower.timer_ms = TOWER_TIMER_MS;
+	stats.agents_updated = 0;
+	stats.agents_boosted = 0;
+
+	// every agent accrues the frame time, it is consumed whenever the agent is updated next
+	for (AIAgent& agent : agent_container.components)
+		agent.pending_ms += elapsed_ms;
+
+	// boosted agents first, those left over from the last frame before the new ones
+	// trees run in batches of AI_BUDGET_CHECK_INTERVAL agents between clock reads
+	bool over_budget = false;
+	size_t next = 0;
+	for (; next < boosted_queue.size(); next++) {
+		if (next > 0 && next % AI_BUDGET_CHECK_INTERVAL == 0) {
+			flush();
+			if (elapsed_us() > budget_us) {
+				// the rest of the queue runs first next frame
+				over_budget = true;
 				break;
 			}
 		}
+
+		// agents may have been removed while queued
+		Entity entity = boosted_queue[next];
+		if (!agent_container.has(entity))
+			continue;
+		AIAgent& agent = agent_container.get(entity);
+		agent.boost_queued = false;
+		if (agent.updated_frame == frame)
+			continue;
+
+		select((unsigned int)(&agent - agent_container.components.data()));
+		stats.agents_boosted++;
 	}
-}
\ No newline at end of file
+	flush();
+	boosted_queue.erase(boosted_queue.begin(), boosted_queue.begin() + next);
+	stats.agents_updated = stats.agents_boosted;
+
+	// round-robin over the remaining agents, one bucket per frame or until the budget is spent
+	// the budget is only checked once some agent was selected, boosted agents alone can't starve the others
+	if (num_agents > 0) {
+		const unsigned int bucket_size = (num_agents + AI_BUCKET_COUNT - 1) / AI_BUCKET_COUNT;
+		unsigned int processed = 0;
+		for (unsigned int visited = 0; visited < num_agents && processed < bucket_size; visited++) {
+			if (visited % AI_BUDGET_CHECK_INTERVAL == 0) {
+				flush();
+				if (processed > 0 && elapsed_us() > budget_us) {
+					// the rest of the bucket is picked up next frame, starting at the cursor
+					over_budget = true;
+					break;
+				}
+			}
+
+			unsigned int i = cursor++ % num_agents;
+			if (agent_container.components[i].updated_frame == frame) continue;
+
+			select(i);
+			processed++;
+		}
+		flush();
+		cursor %= num_agents;
+		stats.agents_updated += processed;
+	}
+
+	if (over_budget)
+		stats.budget_overruns++;
+	stats.agents_skipped = num_agents - stats.agents_updated;
+	stats.frame_us = (float)elapsed_us();
+}
@@ -1,11 +1,83 @@
 #pragma once
 
+#include <array>
+
 #include "common.hpp"
-#include "render_system.hpp"
+#include "behavior_tree.hpp"
 #include "tinyECS/registry.hpp"
 
+// Counters of the time-sliced AI scheduler
+struct AIStats {
+	unsigned int agents_updated = 0;	// last frame
+	unsigned int agents_boosted = 0;	// last frame, updated out of bucket order
+	unsigned int agents_skipped = 0;	// last frame, their pending time carries over
+	unsigned int budget_overruns = 0;	// frames that ran out of budget before finishing their bucket
+	float frame_us = 0;					// time spent in the last step
+};
+
+// Data shared by the behavior tree leaves of one AI step
+struct BTContext {
+	std::vector<float> lane_front_x;	// right-most invader of each lane, or -1 if there is none
+	std::vector<float> lane_tower_x;	// left-most tower of each lane, or -1 if there is none
+	std::vector<vec2> shots;			// projectiles requested by towers, created after all trees ran
+
+	static int lane_of(float y);
+};
+
+// Tower and invader logic, driven by data-defined behavior trees and time-sliced over several frames:
+// - agents near the action (an invader closing in on a tower) are boosted and queued to run first
+// - all other agents are visited round-robin, one bucket of 1/AI_BUCKET_COUNT agents per frame
+// - both count against the per-frame budget, once it is spent the remaining boosted agents stay queued and
+//   the remaining bucket work is deferred to the next frame; every frame still updates at least one batch
+//   of the round-robin agents, so that the boosted ones can't starve them
+// Every agent accumulates the time it did not get to simulate in AIAgent::pending_ms.
+// The agents selected in a frame are grouped by tree and each group is evaluated as one batch.
 class AISystem
 {
 public:
+	// loads all behavior trees
+	bool init();
+
+	// runs the trees, projectiles requested by towers are only collected
 	void step(float elapsed_ms);
-};
\ No newline at end of file
+	// creates the collected projectiles, the only part of the AI that adds entities
+	void spawn_shots();
+
+	void set_budget_us(int budget_us) { this->budget_us = budget_us; }
+	const AIStats& get_stats() const { return stats; }
+
+private:
+	// per lane summary of invaders and towers, rebuilt every frame
+	void build_lanes();
+	// append the agents around the fronts of the engaged lanes to boosted_queue
+	void queue_boosted();
+
+	// queue an agent for this frame's batch of its tree
+	void select(unsigned int agent);
+	// run the selected agents' trees and apply their deferred actions
+	void flush();
+
+	std::array<BehaviorTree, behavior_tree_count> trees;
+	std::array<std::vector<unsigned int>, behavior_tree_count> batches;
+
+	// Make sure these paths remain in sync with the associated enumerators (see BEHAVIOR_TREE_ID).
+	const std::array<std::string, behavior_tree_count> tree_paths = {
+		behavior_path("tower.bt"),
+		behavior_path("invader.bt")
+	};
+
+	BTContext context;
+
+	// invaders and towers of a lane, gathered by build_lanes()
+	struct LaneAgent {
+		float x;
+		Entity entity;
+	};
+	std::vector<std::vector<LaneAgent>> lane_agents;
+	std::vector<Entity> boosted_queue;	// boosted agents not updated yet, oldest first
+
+	unsigned int frame = 0;
+	unsigned int cursor = 0;	// round-robin position in registry.aiAgents
+	int budget_us = AI_FRAME_BUDGET_US;
+	AIStats stats;
+};
@@ -0,0 +1,56 @@
+// Header
+#include "audio_system.hpp"
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+#include <SDL_mixer.h>
+
+AudioSystem::~AudioSystem() {
+	// Destroy music components
+	if (background_music != nullptr)
+		Mix_FreeMusic(background_music);
+	for (Mix_Chunk* sound : sounds)
+		if (sound != nullptr)
+			Mix_FreeChunk(sound);
+	Mix_CloseAudio();
+}
+
+bool AudioSystem::init() {
+
+	//////////////////////////////////////
+	// Loading music and sounds with SDL
+	if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+		fprintf(stderr, "Failed to initialize SDL Audio");
+		return false;
+	}
+
+	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == -1) {
+		fprintf(stderr, "Failed to open audio device");
+		return false;
+	}
+
+	background_music = Mix_LoadMUS(audio_path("music.wav").c_str());
+	bool all_loaded = background_music != nullptr;
+	for (uint i = 0; i < sound_paths.size(); i++) {
+		sounds[i] = Mix_LoadWAV(sound_paths[i].c_str());
+		all_loaded &= sounds[i] != nullptr;
+	}
+
+	if (!all_loaded) {
+		fprintf(stderr, "Failed to load sounds\n %s\n", audio_path("music.wav").c_str());
+		for (const std::string& path : sound_paths)
+			fprintf(stderr, " %s\n", path.c_str());
+		fprintf(stderr, " make sure the data directory is present");
+		return false;
+	}
+
+	return true;
+}
+
+void AudioSystem::play_music() {
+	Mix_PlayMusic(background_music, -1);
+}
+
+void AudioSystem::play(SOUND_ASSET_ID id) {
+	Mix_PlayChannel(-1, sounds[(int)id], 0);
+}
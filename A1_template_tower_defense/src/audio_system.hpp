@@ -0,0 +1,44 @@
+#pragma once
+
+// stlib
+#include <array>
+
+#include "common.hpp"
+
+// SDL_mixer handles, declared here so that users of the audio system do not depend on SDL
+struct _Mix_Music;
+struct Mix_Chunk;
+
+// Sound effects, make sure these stay in sync with AudioSystem::sound_paths
+enum class SOUND_ASSET_ID {
+	CHICKEN_DEAD = 0,
+	CHICKEN_EAT = CHICKEN_DEAD + 1,
+	SOUND_COUNT = CHICKEN_EAT + 1
+};
+const int sound_count = (int)SOUND_ASSET_ID::SOUND_COUNT;
+
+// Music and sound effects. audio_system.cpp plays them with SDL_mixer,
+// headless builds link audio_system_null.cpp instead, which plays nothing.
+class AudioSystem
+{
+public:
+	// starts the audio device and loads music and sound effects
+	bool init();
+
+	// releases all associated resources
+	~AudioSystem();
+
+	// start playing background music indefinitely
+	void play_music();
+
+	void play(SOUND_ASSET_ID id);
+
+private:
+	_Mix_Music* background_music = nullptr;
+	std::array<Mix_Chunk*, sound_count> sounds = {};
+
+	const std::array<std::string, sound_count> sound_paths = {
+		audio_path("chicken_dead.wav"),
+		audio_path("chicken_eat.wav")
+	};
+};
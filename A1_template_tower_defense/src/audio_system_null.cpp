@@ -0,0 +1,17 @@
+// Header
+#include "audio_system.hpp"
+
+// Null audio backend for headless builds, see audio_system.cpp for the SDL one
+
+AudioSystem::~AudioSystem() {
+}
+
+bool AudioSystem::init() {
+	return true;
+}
+
+void AudioSystem::play_music() {
+}
+
+void AudioSystem::play(SOUND_ASSET_ID) {
+}
@@ -0,0 +1,160 @@
+// internal
+#include "behavior_tree.hpp"
+
+// stlib
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+bool BehaviorTree::load(const std::string& path, const std::vector<BTLeaf>& leaves)
+{
+	nodes.clear();
+	leaf_fns.clear();
+	if (compile(path, leaves))
+		return true;
+
+	// a broken tree does nothing rather than half of what it should
+	nodes.clear();
+	leaf_fns.clear();
+	return false;
+}
+
+bool BehaviorTree::compile(const std::string& path, const std::vector<BTLeaf>& leaves)
+{
+	std::ifstream file(path);
+	if (!file.good()) {
+		fprintf(stderr, "Failed to open behavior tree %s\n", path.c_str());
+		return false;
+	}
+
+	// depth of each node, in file (= depth-first) order
+	std::vector<int> depths;
+
+	std::string line;
+	for (int line_number = 1; std::getline(file, line); line_number++) {
+		// strip comments and measure the indentation, a tab counts as one level, two spaces as well
+		line = line.substr(0, line.find('#'));
+		size_t indent = 0, depth = 0;
+		while (indent < line.size() && (line[indent] == ' ' || line[indent] == '\t')) {
+			depth += line[indent] == '\t' ? 2 : 1;
+			indent++;
+		}
+
+		std::stringstream ss(line.substr(indent));
+		std::string keyword, name;
+		ss >> keyword >> name;
+		if (keyword.empty())
+			continue;
+
+		Node node = { NODE_TYPE::LEAF, 1, 0 };
+		if (keyword == "sequence")
+			node.type = NODE_TYPE::SEQUENCE;
+		else if (keyword == "selector")
+			node.type = NODE_TYPE::SELECTOR;
+		else if (keyword == "invert")
+			node.type = NODE_TYPE::INVERT;
+		else if (keyword == "condition" || keyword == "action") {
+			auto leaf = std::find_if(leaves.begin(), leaves.end(), [&name](const BTLeaf& l) { return name == l.name; });
+			if (leaf == leaves.end()) {
+				fprintf(stderr, "%s:%d: unknown %s '%s'\n", path.c_str(), line_number, keyword.c_str(), name.c_str());
+				return false;
+			}
+			auto fn = std::find(leaf_fns.begin(), leaf_fns.end(), leaf->fn);
+			node.leaf = (uint16_t)(fn - leaf_fns.begin());
+			if (fn == leaf_fns.end())
+				leaf_fns.push_back(leaf->fn);
+		}
+		else {
+			fprintf(stderr, "%s:%d: unknown node '%s'\n", path.c_str(), line_number, keyword.c_str());
+			return false;
+		}
+
+		int level = (int)(depth / 2);
+		bool is_root = depths.empty();
+		if ((is_root && level != 0) || (!is_root && (level == 0 || level > depths.back() + 1))) {
+			fprintf(stderr, "%s:%d: unexpected indentation\n", path.c_str(), line_number);
+			return false;
+		}
+		if (!is_root && level == depths.back() + 1 && nodes.back().type == NODE_TYPE::LEAF) {
+			fprintf(stderr, "%s:%d: leaves can not have children\n", path.c_str(), line_number);
+			return false;
+		}
+
+		nodes.push_back(node);
+		depths.push_back(level);
+	}
+
+	if (nodes.empty()) {
+		fprintf(stderr, "Behavior tree %s is empty\n", path.c_str());
+		return false;
+	}
+
+	// a node's subtree extends over all following nodes that are deeper than the node
+	for (size_t i = 0; i < nodes.size(); i++) {
+		size_t end = i + 1;
+		while (end < nodes.size() && depths[end] > depths[i])
+			end++;
+		nodes[i].subtree_size = (uint16_t)(end - i);
+	}
+	for (size_t i = 0; i < nodes.size(); i++) {
+		bool has_children = nodes[i].subtree_size > 1;
+		if (nodes[i].type != NODE_TYPE::LEAF && !has_children) {
+			fprintf(stderr, "Behavior tree %s: composite node %d has no children\n", path.c_str(), (int)i);
+			return false;
+		}
+		if (nodes[i].type == NODE_TYPE::INVERT && nodes[i + 1].subtree_size + 1 != nodes[i].subtree_size) {
+			fprintf(stderr, "Behavior tree %s: invert node %d needs exactly one child\n", path.c_str(), (int)i);
+			return false;
+		}
+	}
+
+	printf("Loaded behavior tree %s (%d nodes)\n", path.c_str(), (int)nodes.size());
+	return true;
+}
+
+BT_STATUS BehaviorTree::evaluate(unsigned int node, BTContext& context, unsigned int agent) const
+{
+	const Node& n = nodes[node];
+	const unsigned int end = node + n.subtree_size;
+
+	switch (n.type) {
+	case NODE_TYPE::LEAF:
+		return leaf_fns[n.leaf](context, agent);
+
+	case NODE_TYPE::SEQUENCE:
+		// runs children in order until one does not succeed
+		for (unsigned int child = node + 1; child < end; child += nodes[child].subtree_size) {
+			BT_STATUS status = evaluate(child, context, agent);
+			if (status != BT_STATUS::SUCCESS)
+				return status;
+		}
+		return BT_STATUS::SUCCESS;
+
+	case NODE_TYPE::SELECTOR:
+		// runs children in order until one does not fail
+		for (unsigned int child = node + 1; child < end; child += nodes[child].subtree_size) {
+			BT_STATUS status = evaluate(child, context, agent);
+			if (status != BT_STATUS::FAILURE)
+				return status;
+		}
+		return BT_STATUS::FAILURE;
+
+	case NODE_TYPE::INVERT: {
+		BT_STATUS status = evaluate(node + 1, context, agent);
+		if (status == BT_STATUS::RUNNING)
+			return status;
+		return status == BT_STATUS::SUCCESS ? BT_STATUS::FAILURE : BT_STATUS::SUCCESS;
+	}
+	}
+	return BT_STATUS::FAILURE;
+}
+
+void BehaviorTree::tick(BTContext& context, const unsigned int* agents, size_t count) const
+{
+	if (nodes.empty())
+		return;
+
+	// all agents walk the same (small, contiguous) node array, which stays in cache for the whole batch
+	for (size_t i = 0; i < count; i++)
+		evaluate(0, context, agents[i]);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// stlib
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tinyECS/components.hpp"
+
+// Behavior trees are written by designers as indented text files in data/behaviors, e.g.
+//
+//   # towers shoot when their timer expired and an invader is in their lane
+//   sequence
+//     action cooldown
+//     condition timer_ready
+//     condition invader_in_lane
+//     action shoot
+//
+// Composite nodes are "sequence", "selector" and "invert" (exactly one child), leaves are
+// "condition <name>" and "action <name>" where <name> is looked up in the leaf table given to load().
+// Trees are re-evaluated from the root on every tick, i.e., they are reactive and keep no running node.
+//
+// Loading compiles a tree into a flat array of nodes in depth-first order. Every node stores the size of
+// its subtree, so the children of a composite are found by skipping over the subtrees of its siblings.
+// Per-agent state lives in the AIAgent component, the compiled tree is shared by all agents using it.
+
+enum class BT_STATUS : uint8_t {
+	SUCCESS = 0,
+	FAILURE = SUCCESS + 1,
+	RUNNING = FAILURE + 1
+};
+
+// Game specific data handed to the leaves, defined by the AI system
+struct BTContext;
+
+// A leaf evaluates a condition or performs an action for the agent at index 'agent' of registry.aiAgents
+using BTLeafFn = BT_STATUS(*)(BTContext& context, unsigned int agent);
+
+struct BTLeaf {
+	const char* name;
+	BTLeafFn fn;
+};
+
+class BehaviorTree
+{
+public:
+	// parse and compile a tree file, leaf names are resolved against 'leaves'
+	bool load(const std::string& path, const std::vector<BTLeaf>& leaves);
+
+	// evaluate the tree for a batch of agents sharing it
+	void tick(BTContext& context, const unsigned int* agents, size_t count) const;
+
+	bool is_loaded() const { return !nodes.empty(); }
+	size_t size() const { return nodes.size(); }
+
+private:
+	enum class NODE_TYPE : uint8_t {
+		SEQUENCE = 0,
+		SELECTOR = SEQUENCE + 1,
+		INVERT = SELECTOR + 1,
+		LEAF = INVERT + 1
+	};
+
+	struct Node {
+		NODE_TYPE type;
+		uint16_t subtree_size;	// number of nodes including this one
+		uint16_t leaf;			// index into leaf_fns, for LEAF nodes
+	};
+
+	bool compile(const std::string& path, const std::vector<BTLeaf>& leaves);
+	BT_STATUS evaluate(unsigned int node, BTContext& context, unsigned int agent) const;
+
+	std::vector<Node> nodes;
+	std::vector<BTLeafFn> leaf_fns;
+};
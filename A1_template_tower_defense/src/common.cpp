@@ -21,6 +21,7 @@ void Transform::translate(vec2 offset)
 	mat = mat * T;
 }
 
+#ifndef HEADLESS
 bool gl_has_errors()
 {
 	GLenum error = glGetError();
@@ -55,4 +56,5 @@ bool gl_has_errors()
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+#endif
@@ -8,8 +8,14 @@
 
 // glfw (OpenGL)
 #define NOMINMAX
+#ifndef HEADLESS
 #include <gl3w.h>
 #include <GLFW/glfw3.h>
+#else
+// headless builds only use the key and mouse button constants, neither GL nor GLFW is linked
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#endif
 
 // The glm library provides vector and matrix operations as in GLSL
 #include <glm/vec2.hpp>				// vec2
@@ -29,6 +35,8 @@ inline std::string shader_path(const std::string& name) {return std::string(PROJ
 inline std::string textures_path(const std::string& name) {return data_path() + "/textures/" + std::string(name);};
 inline std::string audio_path(const std::string& name) {return data_path() + "/audio/" + std::string(name);};
 inline std::string mesh_path(const std::string& name) {return data_path() + "/meshes/" + std::string(name);};
+inline std::string behavior_path(const std::string& name) {return data_path() + "/behaviors/" + std::string(name);};
+inline std::string wave_path(const std::string& name) {return data_path() + "/waves/" + std::string(name);};
 
 //
 // game constants
@@ -39,6 +47,8 @@ const int WINDOW_HEIGHT_PX = 600;
 const int GRID_CELL_WIDTH_PX = 60;
 const int GRID_CELL_HEIGHT_PX = 60;
 const int GRID_LINE_WIDTH_PX = 2;
+const int GRID_COLS = WINDOW_WIDTH_PX / GRID_CELL_WIDTH_PX;
+const int GRID_ROWS = WINDOW_HEIGHT_PX / GRID_CELL_HEIGHT_PX;
 
 const float INVADER_SPEED_BLUE = 50.0f; // Adjust as needed
 const float INVADER_SPEED_GREEN = 100.0f; // Adjust as needed
@@ -49,10 +59,38 @@ const int MAX_TOWERS_START = 5;
 
 const int INVADER_BLUE_HEALTH = 50;
 const int INVADER_GREEN_HEALTH = 20;
-const int INVADER_SPAWN_RATE_MS = 2 * 1000;
 
 const int PROJECTILE_DAMAGE = 10;
 
+// AI time slicing: agents are spread over round-robin buckets, boosted agents run first
+const int AI_FRAME_BUDGET_US = 1000;	// microseconds of AI work per frame before deferring the rest
+const int AI_BUCKET_COUNT = 4;			// a non-boosted agent is updated every AI_BUCKET_COUNT frames, if the budget allows
+const int AI_BUDGET_CHECK_INTERVAL = 64;	// agents visited between clock reads
+const float AI_BOOST_DISTANCE_PX = 4.f * GRID_CELL_WIDTH_PX;	// invader this close to a tower boosts it
+
+// Influence map, see influence_map.hpp
+const float INFLUENCE_THREAT_DECAY_MS = 1500.f;		// time constant with which threat follows invader density
+const float INFLUENCE_DIFFUSION_PER_S = 0.5f;		// fraction of threat exchanged with neighbour cells per second
+const float INFLUENCE_DEBUG_THRESHOLD = 0.05f;		// threat shown in debug mode
+
+// Entity pools, number of dead entities kept for reuse (see entity_pool.hpp)
+const int PROJECTILE_POOL_SIZE = 1024;
+const int INVADER_POOL_SIZE = 256;
+const int EXPLOSION_POOL_SIZE = 64;
+
+// Particles of all emitters together, see particle_system.hpp
+const unsigned int PARTICLE_CAPACITY = 1 << 20;
+
+// Events per step, see event_queue.hpp
+const int COLLISION_EVENT_CAPACITY = 4096;
+const int DAMAGE_EVENT_CAPACITY = 1024;
+
+// Fast-forward, see fast_forward.hpp
+const float SIM_TICK_MS = 1000.f / 60.f;			// fixed simulation step of the game
+const int FAST_FORWARD_SPEED = 64;					// game time per real time
+const int FAST_FORWARD_BUDGET_US = 12000;			// simulation time per frame, caps the ticks of a frame
+const float FAST_FORWARD_RENDER_INTERVAL_MS = 100.f;	// real time between rendered frames
+
 // These are hard coded to the dimensions of the entity's texture
 
 // invaders are 64x64 px, but cells are 60x60
@@ -77,4 +115,6 @@ struct Transform {
 	void translate(vec2 offset);
 };
 
+#ifndef HEADLESS
 bool gl_has_errors();
+#endif
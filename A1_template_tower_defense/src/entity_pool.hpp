@@ -0,0 +1,105 @@
+#pragma once
+
+// stlib
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "tinyECS/prefab.hpp"
+#include "tinyECS/registry.hpp"
+
+// Counters of an entity pool
+struct PoolStats {
+	unsigned int acquired = 0;	// entities handed out
+	unsigned int hits = 0;		// of the acquired entities, how many were recycled
+	unsigned int released = 0;	// entities given back
+	unsigned int dropped = 0;	// of the released entities, how many were destroyed because the pool was full
+};
+
+// Recycles the ids of one prefab kind, e.g., projectiles that are created and destroyed many times a second.
+// A released entity is taken out of the registry (so no system needs to skip inactive entities), only its id
+// is parked in the pool; acquiring it again inserts the prefab values under the old id. The pooled components
+// are plain data, there is no component memory worth keeping. What the pool saves is the release: it only
+// visits the prefab's containers instead of every container of the registry, and it keeps the ids of a kind
+// in a small range instead of drawing new ones.
+// At most 'capacity' ids are parked, entities released beyond that are destroyed.
+template <typename... Components>
+class EntityPool
+{
+	static_assert((std::is_trivially_copyable_v<Components> && ...), "Pooled components are expected to be plain data");
+
+public:
+	EntityPool(const Prefab<Components...>& prefab, size_t capacity) : prefab(prefab)
+	{
+		set_capacity(capacity);
+	}
+
+	void set_capacity(size_t capacity)
+	{
+		this->capacity = capacity;
+		if (parked.size() > capacity)
+			parked.erase(parked.begin() + capacity, parked.end());
+		parked.reserve(capacity);
+	}
+
+	// same as spawn() (see prefab.hpp), but prefers a parked entity over a new one
+	template <typename InitFn>
+	Entity acquire(InitFn init_fn)
+	{
+		stats.acquired++;
+		if (parked.empty())
+			return spawn(prefab, init_fn);
+
+		stats.hits++;
+		Entity entity = parked.back();
+		parked.pop_back();
+		std::apply([&](const PrefabPart<Components>&... parts) {
+			// a parked entity has no components left, skip the duplicate check
+			init_fn(entity, parts.container->insert(entity, parts.value, false)...);
+		}, prefab.parts);
+		return entity;
+	}
+
+	// same as spawn_batch() (see prefab.hpp), parked entities are used first
+	template <typename InitFn>
+	void acquire_batch(size_t count, InitFn init_fn)
+	{
+		if (count == 0)
+			return;
+		std::apply([count](const PrefabPart<Components>&... parts) { (parts.container->reserve(count), ...); }, prefab.parts);
+
+		for (size_t i = 0; i < count; i++)
+			acquire([&](Entity entity, Components&... components) { init_fn(i, entity, components...); });
+	}
+
+	// removes the prefab components of the entity from the registry and parks its id, if there is room
+	// pooled entities must not get other components, only the prefab's containers are visited
+	void release(Entity entity)
+	{
+		stats.released++;
+		if (parked.size() < capacity)
+			parked.push_back(entity);
+		else
+			stats.dropped++;
+		std::apply([&](const PrefabPart<Components>&... parts) { (parts.container->remove(entity), ...); }, prefab.parts);
+		assert(!registry.has_any_component(entity) && "Pooled entity got a component outside of its prefab");
+	}
+
+	const PoolStats& get_stats() const { return stats; }
+	size_t size() const { return parked.size(); }
+
+private:
+	Prefab<Components...> prefab;
+	size_t capacity = 0;
+
+	std::vector<Entity> parked;
+
+	PoolStats stats;
+};
+
+template <typename... Components>
+EntityPool<Components...> make_pool(const Prefab<Components...>& prefab, size_t capacity)
+{
+	return EntityPool<Components...>(prefab, capacity);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+// stlib
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Typed, double-buffered event channel backed by a ring buffer.
+// Producers push() the events of a step, any number of threads at once (a slot is claimed with one atomic
+// increment, no lock). Once the producing system is done it calls publish(): the events of this step become
+// readable and those of the step before are dropped. Readers keep their own cursor, so several systems can
+// read the same events, each of them once. Pushes and publish() must not overlap, the scheduler orders them.
+// Events that do not fit into the ring in one step are dropped and counted.
+template <typename Event>
+class EventQueue
+{
+public:
+	// position of one reader in the queue
+	class Reader
+	{
+		friend class EventQueue;
+		uint64_t cursor = 0;
+	};
+
+	// the capacity is rounded up to a power of two
+	EventQueue(size_t capacity)
+	{
+		size_t size = 1;
+		while (size < capacity)
+			size *= 2;
+		events.resize(size);
+	}
+
+	bool push(const Event& event)
+	{
+		uint64_t sequence = write_head.fetch_add(1, std::memory_order_relaxed);
+		if (sequence - readable_begin >= events.size()) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		events[sequence & (events.size() - 1)] = event;
+		return true;
+	}
+
+	// makes the pushed events readable, and drops the ones published before
+	void publish()
+	{
+		uint64_t end = std::min<uint64_t>(write_head, readable_begin + events.size());
+		readable_begin = readable_end;
+		readable_end = end;
+		write_head = end;
+	}
+
+	// calls function(event) for every published event the reader has not seen yet, in push order
+	template <typename Function>
+	void read(Reader& reader, Function function) const
+	{
+		for (uint64_t sequence = std::max(reader.cursor, readable_begin); sequence < readable_end; sequence++)
+			function(*events[sequence & (events.size() - 1)]);
+		reader.cursor = readable_end;
+	}
+
+	// drops all events, e.g., on restart
+	void clear()
+	{
+		readable_begin = readable_end = write_head;
+	}
+
+	size_t readable() const { return (size_t)(readable_end - readable_begin); }
+	unsigned int get_dropped() const { return dropped; }
+
+private:
+	// optional since events may hold entities, which can't be default constructed without drawing an id
+	std::vector<std::optional<Event>> events;
+
+	// sequence numbers: [readable_begin, readable_end) can be read, [readable_end, write_head) is being written
+	uint64_t readable_begin = 0;
+	uint64_t readable_end = 0;
+	std::atomic<uint64_t> write_head{ 0 };
+	std::atomic<unsigned int> dropped{ 0 };
+};
@@ -0,0 +1,5 @@
+// internal
+#include "events.hpp"
+
+EventQueue<CollisionEvent> collision_events(COLLISION_EVENT_CAPACITY);
+EventQueue<DamageEvent> damage_events(DAMAGE_EVENT_CAPACITY);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common.hpp"
+#include "event_queue.hpp"
+#include "tinyECS/entity.hpp"
+
+// Two entities that overlap, reported once per pair by the physics system
+struct CollisionEvent {
+	Entity first;
+	Entity second;
+};
+
+// Damage dealt to an entity, e.g., by a projectile
+struct DamageEvent {
+	Entity target;
+	int amount;
+};
+
+extern EventQueue<CollisionEvent> collision_events;
+extern EventQueue<DamageEvent> damage_events;
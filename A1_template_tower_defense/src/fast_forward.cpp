@@ -0,0 +1,50 @@
+// internal
+#include "fast_forward.hpp"
+
+// stlib
+#include <algorithm>
+
+void FastForward::set_mode(FAST_FORWARD_MODE mode)
+{
+	this->mode = mode;
+	pending_ticks = 0.f;
+	since_render_ms = 0.f;
+}
+
+int FastForward::plan(float frame_ms)
+{
+	int affordable = std::max(1, (int)(FAST_FORWARD_BUDGET_US / tick_us));
+	if (mode == FAST_FORWARD_MODE::UNTIL_WAVE_END)
+		return affordable;
+
+	pending_ticks += frame_ms * speed() / SIM_TICK_MS;
+	int ticks = std::min((int)pending_ticks, affordable);
+	// game time that did not fit into the budget is dropped, catching up later would only make the next frames slower
+	pending_ticks = ticks < affordable ? pending_ticks - ticks : 0.f;
+	return ticks;
+}
+
+float FastForward::ms_until_next_tick() const
+{
+	if (mode == FAST_FORWARD_MODE::UNTIL_WAVE_END)
+		return 0.f;
+	return std::max(0.f, 1.f - pending_ticks) * SIM_TICK_MS / speed();
+}
+
+void FastForward::add_tick_time(float us)
+{
+	tick_us += (us - tick_us) * 0.1f;
+	tick_us = std::max(tick_us, 1.f);
+}
+
+bool FastForward::should_render(float frame_ms)
+{
+	if (mode == FAST_FORWARD_MODE::OFF)
+		return true;
+
+	since_render_ms += frame_ms;
+	if (since_render_ms < FAST_FORWARD_RENDER_INTERVAL_MS)
+		return false;
+	since_render_ms = 0.f;
+	return true;
+}
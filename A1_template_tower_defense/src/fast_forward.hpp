@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common.hpp"
+
+enum class FAST_FORWARD_MODE {
+	OFF = 0,
+	SPEED = OFF + 1,			// FAST_FORWARD_SPEED times faster than real time
+	UNTIL_WAVE_END = SPEED + 1	// as fast as the budget allows, until the next wave starts
+};
+
+// Paces the fixed SIM_TICK_MS ticks of the game and accelerates time: a frame runs the ticks that came due in
+// its real time, FAST_FORWARD_SPEED times as many while fast-forwarding. The number of ticks is capped by the
+// measured cost of a tick, so that the simulation of a frame stays within FAST_FORWARD_BUDGET_US; the game
+// falls behind the requested speed rather than freezing.
+// While fast-forwarding only every FAST_FORWARD_RENDER_INTERVAL_MS a frame is rendered.
+class FastForward
+{
+public:
+	void set_mode(FAST_FORWARD_MODE mode);
+	FAST_FORWARD_MODE get_mode() const { return mode; }
+	bool is_on() const { return mode != FAST_FORWARD_MODE::OFF; }
+
+	// number of ticks to run in a frame that took 'frame_ms' of real time
+	int plan(float frame_ms);
+	// real time until plan() has the next tick due
+	float ms_until_next_tick() const;
+	// report how long one of the ticks took
+	void add_tick_time(float us);
+
+	// whether the frame should be drawn
+	bool should_render(float frame_ms);
+
+private:
+	float speed() const { return mode == FAST_FORWARD_MODE::SPEED ? (float)FAST_FORWARD_SPEED : 1.f; }
+
+	FAST_FORWARD_MODE mode = FAST_FORWARD_MODE::OFF;
+	float tick_us = 100.f;			// moving average of the cost of a tick
+	float pending_ticks = 0.f;		// fraction of a tick carried to the next frame
+	float since_render_ms = 0.f;
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+// stlib
+#include <array>
+#include <climits>
+
+#include "common.hpp"
+
+// Counters of one rendered frame
+struct RenderStats {
+	unsigned int draw_calls = 0;
+	unsigned int state_changes = 0;	// program, buffer, vertex array, texture and framebuffer binds that reached GL
+	unsigned int redundant = 0;		// binds skipped since the object was bound already
+};
+
+// Remembers which GL objects are bound and skips binds that would not change anything.
+// All binds and draws of the render system go through it, textures are only bound to unit 0.
+// After GL state was changed behind its back (e.g., while loading assets), call invalidate().
+class GlState
+{
+public:
+	void use_program(GLuint program)
+	{
+		if (changes(bound_program, program))
+			glUseProgram(program);
+	}
+
+	void bind_array_buffer(GLuint buffer)
+	{
+		if (changes(bound_array_buffer, buffer))
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	}
+
+	// the index buffer binding is part of the vertex array
+	void bind_vertex_array(GLuint vertex_array)
+	{
+		if (changes(bound_vertex_array, vertex_array))
+			glBindVertexArray(vertex_array);
+	}
+
+	void bind_texture(GLenum target, GLuint texture)
+	{
+		GLuint& bound = target == GL_TEXTURE_2D ? bound_textures[0] : bound_textures[1];
+		if (!changes(bound, texture))
+			return;
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(target, texture);
+	}
+
+	void bind_framebuffer(GLuint framebuffer)
+	{
+		if (changes(bound_framebuffer, framebuffer))
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+
+	void draw_elements(GLenum mode, GLsizei count)
+	{
+		glDrawElements(mode, count, GL_UNSIGNED_SHORT, nullptr);
+		stats.draw_calls++;
+	}
+
+	void draw_elements_instanced(GLenum mode, GLsizei count, GLsizei instances)
+	{
+		glDrawElementsInstanced(mode, count, GL_UNSIGNED_SHORT, nullptr, instances);
+		stats.draw_calls++;
+	}
+
+	void draw_arrays(GLenum mode, GLint first, GLsizei count)
+	{
+		glDrawArrays(mode, first, count);
+		stats.draw_calls++;
+	}
+
+	// forget the bound objects, the next bind of each kind reaches GL
+	void invalidate()
+	{
+		bound_program = bound_array_buffer = bound_vertex_array = bound_framebuffer = UNKNOWN;
+		bound_textures.fill(UNKNOWN);
+	}
+
+	// returns the counters of the frame that ended and starts counting the next one
+	RenderStats end_frame()
+	{
+		RenderStats frame = stats;
+		stats = RenderStats();
+		return frame;
+	}
+
+private:
+	static const GLuint UNKNOWN = UINT_MAX;
+
+	// whether binding 'object' changes 'bound', which is updated
+	bool changes(GLuint& bound, GLuint object)
+	{
+		if (bound == object) {
+			stats.redundant++;
+			return false;
+		}
+		bound = object;
+		stats.state_changes++;
+		return true;
+	}
+
+	GLuint bound_program = UNKNOWN;
+	GLuint bound_array_buffer = UNKNOWN;
+	GLuint bound_vertex_array = UNKNOWN;
+	GLuint bound_framebuffer = UNKNOWN;
+	std::array<GLuint, 2> bound_textures = { UNKNOWN, UNKNOWN };	// GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY
+	RenderStats stats;
+};
@@ -0,0 +1,178 @@
+// internal
+#include "influence_map.hpp"
+#include "simd.hpp"
+
+// stlib
+#include <cmath>
+
+InfluenceMap influence_map;
+
+int InfluenceSnapshot::cell_of(vec2 position)
+{
+	if (position.x < 0.f || position.y < 0.f)
+		return -1;
+	int col = (int)(position.x / GRID_CELL_WIDTH_PX);
+	int row = (int)(position.y / GRID_CELL_HEIGHT_PX);
+	if (col >= GRID_COLS || row >= GRID_ROWS)
+		return -1;
+	return influence_index(col, row);
+}
+
+float InfluenceSnapshot::sample(const Layer& layer, vec2 position) const
+{
+	int cell = cell_of(position);
+	return cell < 0 ? 0.f : layer[cell];
+}
+
+int InfluenceSnapshot::best_tower_row() const
+{
+	int best_row = -1;
+	float best_score = 0.f;
+	for (int row = 0; row < GRID_ROWS; row++) {
+		float row_threat = 0.f, row_damage = 0.f;
+		for (int col = 0; col < GRID_COLS; col++) {
+			row_threat += threat[influence_index(col, row)];
+			row_damage += damage_potential[influence_index(col, row)];
+		}
+		float score = row_threat / (1.f + row_damage);
+		if (score > best_score) {
+			best_score = score;
+			best_row = row;
+		}
+	}
+	return best_row;
+}
+
+int InfluenceSnapshot::safest_lane() const
+{
+	int best_row = 0;
+	float best_damage = 0.f;
+	for (int row = 0; row < GRID_ROWS; row++) {
+		float row_damage = 0.f;
+		for (int col = 0; col < GRID_COLS; col++)
+			row_damage += damage_potential[influence_index(col, row)];
+		if (row == 0 || row_damage < best_damage) {
+			best_damage = row_damage;
+			best_row = row;
+		}
+	}
+	return best_row;
+}
+
+float InfluenceSnapshot::total_threat() const
+{
+	float sum = 0.f;
+	for (float t : threat)
+		sum += t;
+	return sum;
+}
+
+InfluenceMap::InfluenceMap()
+{
+	clear();
+}
+
+void InfluenceMap::clear()
+{
+	invader_density.fill(0.f);
+	tower_coverage.fill(0.f);
+	damage_potential.fill(0.f);
+	for (InfluenceSnapshot& snapshot : snapshots) {
+		snapshot.invader_density.fill(0.f);
+		snapshot.tower_coverage.fill(0.f);
+		snapshot.damage_potential.fill(0.f);
+		snapshot.threat.fill(0.f);
+	}
+}
+
+int InfluenceMap::add_invader(vec2 position)
+{
+	int cell = InfluenceSnapshot::cell_of(position);
+	if (cell >= 0)
+		invader_density[cell] += 1.f;
+	return cell;
+}
+
+void InfluenceMap::remove_invader(int cell)
+{
+	if (cell >= 0)
+		invader_density[cell] -= 1.f;
+}
+
+int InfluenceMap::move_invader(int cell, vec2 position)
+{
+	int new_cell = InfluenceSnapshot::cell_of(position);
+	if (new_cell != cell) {
+		remove_invader(cell);
+		if (new_cell >= 0)
+			invader_density[new_cell] += 1.f;
+	}
+	return new_cell;
+}
+
+void InfluenceMap::update_tower(vec2 position, float range_cells, float sign)
+{
+	int cell = InfluenceSnapshot::cell_of(position);
+	if (cell < 0)
+		return;
+
+	// towers shoot to the left, along their row
+	const float damage_per_s = sign * PROJECTILE_DAMAGE * 1000.f / TOWER_TIMER_MS;
+	int tower_col = (int)(position.x / GRID_CELL_WIDTH_PX);
+	int row = (int)(position.y / GRID_CELL_HEIGHT_PX);
+	for (int col = std::max(0, tower_col - (int)range_cells); col <= tower_col; col++) {
+		tower_coverage[influence_index(col, row)] += sign;
+		damage_potential[influence_index(col, row)] += damage_per_s;
+	}
+}
+
+void InfluenceMap::add_tower(vec2 position, float range_cells)
+{
+	update_tower(position, range_cells, 1.f);
+}
+
+void InfluenceMap::remove_tower(vec2 position, float range_cells)
+{
+	update_tower(position, range_cells, -1.f);
+}
+
+void InfluenceMap::step(float elapsed_ms)
+{
+	const InfluenceSnapshot& prev = snapshots[front];
+	InfluenceSnapshot& next = snapshots[1 - front];
+
+	// the raw layers are already up to date, just publish them
+	next.invader_density = invader_density;
+	next.tower_coverage = tower_coverage;
+	next.damage_potential = damage_potential;
+
+	// threat follows the invader density with a time constant and spreads to the 4 neighbours:
+	// t' = t + d * (t_left + t_right + t_up + t_down - 4 t) + a * (density - t)
+	const float a = 1.f - expf(-elapsed_ms / INFLUENCE_THREAT_DECAY_MS);
+	const float d = std::min(0.2f, INFLUENCE_DIFFUSION_PER_S * elapsed_ms / 1000.f); // stable below 0.25
+	const simd::float4 blend = simd::splat(a);
+	const simd::float4 diffusion = simd::splat(d);
+	const simd::float4 four = simd::splat(4.f);
+	const simd::float4 zero = simd::splat(0.f);
+
+	const float* t = prev.threat.data();
+	const float* density = invader_density.data();
+	float* out = next.threat.data();
+	for (int i = INFLUENCE_STRIDE; i < INFLUENCE_CELLS - INFLUENCE_STRIDE; i += 4) {
+		simd::float4 center = simd::load(t + i);
+		simd::float4 neighbours = simd::load(t + i - 1) + simd::load(t + i + 1)
+			+ simd::load(t + i - INFLUENCE_STRIDE) + simd::load(t + i + INFLUENCE_STRIDE);
+		simd::float4 laplacian = neighbours - four * center;
+		simd::float4 result = center + diffusion * laplacian + blend * (simd::load(density + i) - center);
+		simd::store(out + i, simd::max(result, zero));
+	}
+
+	// keep the border at zero, influence leaving the field is lost
+	for (int row = 1; row <= GRID_ROWS; row++) {
+		out[row * INFLUENCE_STRIDE] = 0.f;
+		for (int col = GRID_COLS + 1; col < INFLUENCE_STRIDE; col++)
+			out[row * INFLUENCE_STRIDE + col] = 0.f;
+	}
+
+	front = 1 - front;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+
+#include "common.hpp"
+
+// The influence grid has a one cell border (always zero) around the GRID_COLS x GRID_ROWS play field,
+// so the diffusion kernel can read its neighbours without bounds checks.
+// The row stride is padded to a multiple of 4 for the SIMD kernels.
+const int INFLUENCE_STRIDE = (GRID_COLS + 2 + 3) / 4 * 4;
+const int INFLUENCE_CELLS = INFLUENCE_STRIDE * (GRID_ROWS + 2);
+
+inline int influence_index(int col, int row) { return (row + 1) * INFLUENCE_STRIDE + (col + 1); }
+
+// Read-only view of the influence map, published once per step.
+// AI and debug rendering sample it, it is never modified outside of InfluenceMap::step.
+struct InfluenceSnapshot
+{
+	using Layer = std::array<float, INFLUENCE_CELLS>;
+
+	Layer invader_density;		// invaders per cell
+	Layer tower_coverage;		// towers that can shoot into the cell
+	Layer damage_potential;		// damage per second the covering towers can deal
+	Layer threat;				// invader density, diffused and smoothed over time
+
+	// cell index of a position in window coordinates, -1 if outside of the grid
+	static int cell_of(vec2 position);
+
+	float sample(const Layer& layer, vec2 position) const;
+
+	// tower placement advice: the row where the most threat meets the least damage potential
+	int best_tower_row() const;
+	// invader lane choice: the row with the least damage potential
+	int safest_lane() const;
+	// difficulty scaling: sum of the threat over the field
+	float total_threat() const;
+};
+
+// Per cell threat and influence grid, maintained incrementally:
+// spawns, deaths and cell changes of invaders as well as tower placement update the raw layers directly,
+// and step() only runs the decay/diffusion kernel before publishing a new snapshot.
+class InfluenceMap
+{
+public:
+	InfluenceMap();
+
+	// remove all influence, e.g., on restart
+	void clear();
+
+	// invader deltas, return the cell the invader is now accounted in (or -1)
+	int add_invader(vec2 position);
+	void remove_invader(int cell);
+	int move_invader(int cell, vec2 position);
+
+	// tower deltas, a tower covers range_cells of its row towards the left
+	void add_tower(vec2 position, float range_cells);
+	void remove_tower(vec2 position, float range_cells);
+
+	// advance threat by elapsed_ms and publish a new snapshot
+	void step(float elapsed_ms);
+
+	const InfluenceSnapshot& snapshot() const { return snapshots[front]; }
+
+private:
+	void update_tower(vec2 position, float range_cells, float sign);
+
+	InfluenceSnapshot::Layer invader_density;
+	InfluenceSnapshot::Layer tower_coverage;
+	InfluenceSnapshot::Layer damage_potential;
+
+	// double buffered, the back snapshot is written while the front one is read
+	std::array<InfluenceSnapshot, 2> snapshots;
+	int front = 0;
+};
+
+extern InfluenceMap influence_map;
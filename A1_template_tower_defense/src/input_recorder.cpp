@@ -0,0 +1,157 @@
+// internal
+#include "input_recorder.hpp"
+
+// stlib
+#include <cstring>
+#include <iterator>
+
+namespace {
+	const char INPUT_MAGIC[4] = { 'T', 'D', 'I', 'R' };
+	const uint32_t INPUT_VERSION = 1;
+}
+
+bool InputRecorder::start(const std::string& path, unsigned int seed)
+{
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file.good()) {
+		fprintf(stderr, "Failed to open input recording %s\n", path.c_str());
+		return false;
+	}
+	file.write(INPUT_MAGIC, sizeof(INPUT_MAGIC));
+	write<uint32_t>(INPUT_VERSION);
+	write<uint32_t>(seed);
+	ticks = 0;
+	return true;
+}
+
+void InputRecorder::tick(float elapsed_ms)
+{
+	if (!is_recording())
+		return;
+	write(INPUT_RECORD::TICK);
+	write(elapsed_ms);
+	ticks++;
+}
+
+void InputRecorder::key(int key, int action, int mods)
+{
+	if (!is_recording())
+		return;
+	write(INPUT_RECORD::KEY);
+	write((int16_t)key);
+	write((uint8_t)action);
+	write((uint8_t)mods);
+}
+
+void InputRecorder::mouse_move(vec2 position)
+{
+	if (!is_recording())
+		return;
+	write(INPUT_RECORD::MOUSE_MOVE);
+	write(position.x);
+	write(position.y);
+}
+
+void InputRecorder::mouse_button(int button, int action, int mods)
+{
+	if (!is_recording())
+		return;
+	write(INPUT_RECORD::MOUSE_BUTTON);
+	write((uint8_t)button);
+	write((uint8_t)action);
+	write((uint8_t)mods);
+}
+
+void InputRecorder::stop(uint64_t state_hash)
+{
+	if (!is_recording())
+		return;
+	write(INPUT_RECORD::END);
+	write((uint32_t)ticks);
+	write(state_hash);
+	file.close();
+	printf("Recorded %u ticks of input\n", ticks);
+}
+
+bool InputReplay::load(const std::string& path)
+{
+	data.clear();
+	cursor = 0;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.good()) {
+		fprintf(stderr, "Failed to open input recording %s\n", path.c_str());
+		return false;
+	}
+	std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	data = std::move(contents);
+	char magic[4] = {};
+	uint32_t version = 0, recorded_seed = 0;
+	for (char& c : magic)
+		read(c);
+	if (memcmp(magic, INPUT_MAGIC, sizeof(magic)) != 0 || !read(version) || version != INPUT_VERSION || !read(recorded_seed)) {
+		fprintf(stderr, "%s is not an input recording of this version\n", path.c_str());
+		data.clear();
+		return false;
+	}
+	seed = recorded_seed;
+	return true;
+}
+
+template <typename T>
+bool InputReplay::read(T& value)
+{
+	if (cursor + sizeof(T) > data.size())
+		return false;
+	memcpy(&value, data.data() + cursor, sizeof(T));
+	cursor += sizeof(T);
+	return true;
+}
+
+bool InputReplay::next(InputEvent& event)
+{
+	event = InputEvent();
+	if (!read(event.type))
+		return false;
+
+	switch (event.type) {
+	case INPUT_RECORD::TICK:
+		return read(event.elapsed_ms);
+
+	case INPUT_RECORD::KEY: {
+		int16_t key;
+		uint8_t action, mods;
+		if (!read(key) || !read(action) || !read(mods))
+			return false;
+		event.key = key;
+		event.action = action;
+		event.mods = mods;
+		return true;
+	}
+
+	case INPUT_RECORD::MOUSE_MOVE:
+		return read(event.position.x) && read(event.position.y);
+
+	case INPUT_RECORD::MOUSE_BUTTON: {
+		uint8_t button, action, mods;
+		if (!read(button) || !read(action) || !read(mods))
+			return false;
+		event.key = button;
+		event.action = action;
+		event.mods = mods;
+		return true;
+	}
+
+	case INPUT_RECORD::END: {
+		uint32_t ticks;
+		if (!read(ticks) || !read(event.state_hash))
+			return false;
+		event.ticks = ticks;
+		return true;
+	}
+	}
+
+	fprintf(stderr, "Corrupt input recording, unknown record %d\n", (int)event.type);
+	return false;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// stlib
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+// Input recordings are compact binary files:
+//   header:  "TDIR", format version (uint32), RNG seed (uint32)
+//   records: a type byte followed by its payload
+//     TICK          elapsed_ms (float)               one per simulation step
+//     KEY           key (int16), action, mods (uint8)
+//     MOUSE_MOVE    x, y (float)
+//     MOUSE_BUTTON  button, action, mods (uint8)
+//     END           ticks (uint32), state hash (uint64)
+// Input events are stored in front of the tick they were handled in, so the tick number of an
+// event is the number of TICK records before it. Values are stored in the machine's byte order.
+enum class INPUT_RECORD : uint8_t {
+	TICK = 0,
+	KEY = TICK + 1,
+	MOUSE_MOVE = KEY + 1,
+	MOUSE_BUTTON = MOUSE_MOVE + 1,
+	END = MOUSE_BUTTON + 1
+};
+
+struct InputEvent {
+	INPUT_RECORD type = INPUT_RECORD::END;
+	int key = 0;			// key or mouse button
+	int action = 0;
+	int mods = 0;
+	vec2 position = { 0, 0 };
+	float elapsed_ms = 0;
+	unsigned int ticks = 0;
+	uint64_t state_hash = 0;
+};
+
+class InputRecorder
+{
+public:
+	bool start(const std::string& path, unsigned int seed);
+	bool is_recording() const { return file.is_open(); }
+
+	void tick(float elapsed_ms);
+	void key(int key, int action, int mods);
+	void mouse_move(vec2 position);
+	void mouse_button(int button, int action, int mods);
+
+	// writes the END record, the state hash lets a replay check that it arrived at the same state
+	void stop(uint64_t state_hash);
+
+private:
+	template <typename T>
+	void write(T value) { file.write((const char*)&value, sizeof(T)); }
+
+	std::ofstream file;
+	unsigned int ticks = 0;
+};
+
+class InputReplay
+{
+public:
+	bool load(const std::string& path);
+	bool is_loaded() const { return !data.empty(); }
+	unsigned int get_seed() const { return seed; }
+
+	// reads the next record, returns false at the end of the file
+	bool next(InputEvent& event);
+
+private:
+	template <typename T>
+	bool read(T& value);
+
+	std::vector<char> data;
+	size_t cursor = 0;
+	unsigned int seed = 0;
+};
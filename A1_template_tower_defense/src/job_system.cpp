@@ -0,0 +1,156 @@
+// internal
+#include "job_system.hpp"
+
+JobSystem job_system;
+
+namespace {
+	// index of the queue of the current thread
+	thread_local unsigned int this_queue = 0;
+}
+
+JobSystem::JobSystem(unsigned int num_workers)
+{
+	if (num_workers == 0)
+		num_workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+	for (unsigned int i = 0; i < num_workers + 1; i++)
+		queues.push_back(std::make_unique<Queue>());
+	for (unsigned int i = 1; i < num_workers + 1; i++)
+		workers.emplace_back([this, i]() { work(i); });
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+JobHandle JobSystem::create(std::function<void()> function, const std::vector<JobHandle>& dependencies)
+{
+	JobHandle job = std::make_shared<Job>();
+	job->function = std::move(function);
+
+	// one extra dependency while the others are registered, so that the job can't be queued half way
+	job->unfinished_dependencies = 1;
+	for (const JobHandle& dependency : dependencies) {
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (!dependency->done) {
+			job->unfinished_dependencies++;
+			dependency->continuations.push_back(job);
+		}
+	}
+	if (--job->unfinished_dependencies == 0)
+		submit(job);
+	return job;
+}
+
+void JobSystem::submit(JobHandle job)
+{
+	Queue& queue = *queues[this_queue];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	queued++;
+
+	// taking the lock orders the increment before a worker's check of 'queued', no wake up is lost
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+	}
+	wake.notify_one();
+}
+
+void JobSystem::finish(const JobHandle& job)
+{
+	std::vector<JobHandle> ready;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->done = true;
+		ready.swap(job->continuations);
+	}
+	for (JobHandle& continuation : ready)
+		if (--continuation->unfinished_dependencies == 0)
+			submit(std::move(continuation));
+}
+
+bool JobSystem::run_one()
+{
+	JobHandle job;
+
+	// own queue first, newest job
+	{
+		Queue& queue = *queues[this_queue];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+		}
+	}
+
+	// steal the oldest job of another thread
+	for (size_t i = 1; !job && i < queues.size(); i++) {
+		Queue& queue = *queues[(this_queue + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+		}
+	}
+
+	if (!job)
+		return false;
+	queued--;
+	job->function();
+	finish(job);
+	return true;
+}
+
+void JobSystem::wait(const JobHandle& job)
+{
+	// help while waiting, the job may well be in our own queue
+	while (!job->done) {
+		if (!run_one())
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function)
+{
+	if (count == 0)
+		return;
+	grain = std::max<size_t>(grain, 1);
+
+	// a single range is not worth a job
+	if (count <= grain || workers.empty()) {
+		function(0, count);
+		return;
+	}
+
+	std::vector<JobHandle> jobs;
+	jobs.reserve((count + grain - 1) / grain);
+	for (size_t begin = 0; begin < count; begin += grain) {
+		size_t end = std::min(begin + grain, count);
+		jobs.push_back(create([&function, begin, end]() { function(begin, end); }));
+	}
+	for (const JobHandle& job : jobs)
+		wait(job);
+}
+
+void JobSystem::work(unsigned int queue)
+{
+	this_queue = queue;
+	while (true) {
+		if (run_one())
+			continue;
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		wake.wait(lock, [this]() { return quit || queued > 0; });
+		if (quit)
+			return;
+	}
+}
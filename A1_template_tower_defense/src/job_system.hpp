@@ -0,0 +1,90 @@
+#pragma once
+
+// stlib
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tinyECS/tiny_ecs.hpp"
+
+// A unit of work, runs once all jobs it depends on finished
+struct Job
+{
+	std::function<void()> function;
+	std::atomic<bool> done{ false };
+
+private:
+	friend class JobSystem;
+	std::atomic<int> unfinished_dependencies{ 0 };
+	std::mutex mutex;							// guards done (while finishing) and continuations
+	std::vector<std::shared_ptr<Job>> continuations;	// jobs waiting for this one
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+// Work-stealing thread pool. Every thread (the workers and the main thread) has its own deque of ready jobs:
+// a thread pushes the jobs it creates to the back of its deque and pops from the back (most recent first,
+// the data is likely still in cache), idle threads steal from the front of the other deques.
+// The main thread is not a worker, it only runs jobs while it waits in wait() or parallel_for(),
+// so that GL and GLFW calls stay on the main thread and everything else may use the workers.
+// Jobs must not insert into or remove from the registry containers, only modify existing components or
+// write to storage owned by the job; the creator merges the results after waiting.
+class JobSystem
+{
+public:
+	// 0 threads: one less than the hardware threads, the main thread is the last one
+	JobSystem(unsigned int num_workers = 0);
+	~JobSystem();
+
+	// the job is queued once all dependencies finished (immediately if there are none)
+	JobHandle create(std::function<void()> function, const std::vector<JobHandle>& dependencies = {});
+
+	// runs other jobs until the job finished
+	void wait(const JobHandle& job);
+
+	// calls function(begin, end) for consecutive ranges of at most 'grain' indices below 'count', and waits
+	void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function);
+
+	// calls function(entity, component) for every component of the container, 'grain' components per job
+	template <typename Component, typename Function>
+	void parallel_for(ComponentContainer<Component>& container, size_t grain, Function function)
+	{
+		parallel_for(container.components.size(), grain, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				function(container.entities[i], container.components[i]);
+		});
+	}
+
+	// workers plus the main thread
+	unsigned int get_thread_count() const { return (unsigned int)workers.size() + 1; }
+
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<JobHandle> jobs;
+	};
+
+	void submit(JobHandle job);
+	void finish(const JobHandle& job);
+	// pops a job of this thread's queue or steals one, returns false if there was nothing to do
+	bool run_one();
+	void work(unsigned int queue);
+
+	// queue 0 belongs to the main thread (and any thread that is not a worker)
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	// sleeping workers wait for queued jobs
+	std::mutex sleep_mutex;
+	std::condition_variable wake;
+	std::atomic<int> queued{ 0 };
+	bool quit = false;
+};
+
+extern JobSystem job_system;
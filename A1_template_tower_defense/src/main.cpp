@@ -4,18 +4,36 @@
 
 // stdlib
 #include <chrono>
+#include <climits>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
 // internal
 #include "ai_system.hpp"
+#include "particle_system.hpp"
 #include "physics_system.hpp"
 #include "render_system.hpp"
+#include "systems.hpp"
+#include "world_init.hpp"
 #include "world_system.hpp"
 
 using Clock = std::chrono::high_resolution_clock;
 
+namespace {
+	void print_usage()
+	{
+		fprintf(stderr,
+			"usage: tower_defense [options]\n"
+			"  --record FILE     save all input to FILE\n"
+			"  --replay FILE     play FILE back instead of the live input\n"
+			"  --gpu-particles   simulate the particles on the GPU\n"
+			"  --pool NAME N     keep up to N dead projectile/invader/explosion entities for reuse\n");
+	}
+}
+
 // Entry point
-int main()
+int main(int argc, char* argv[])
 {
 	// global systems
 	AISystem	  ai_system;
@@ -36,14 +54,60 @@ int main()
 		std::cerr << "ERROR: Failed to start or load sounds." << std::endl;
 	}
 
+	// command line options, see print_usage (--gpu-particles: RenderSystem::drawGpuParticles)
+	bool recorded = false;
+	for (int i = 1; i < argc; i++) {
+		bool has_value = i + 1 < argc;
+		if (strcmp(argv[i], "--gpu-particles") == 0) {
+			particle_pool.simulate_on_gpu = true;
+		}
+		else if (i + 2 < argc && strcmp(argv[i], "--pool") == 0) {
+			POOL_ID pool;
+			if (!find_pool(argv[i + 1], pool))
+				return EXIT_FAILURE;
+			set_pool_capacity(pool, (size_t)atoi(argv[i + 2]));
+			i += 2;
+		}
+		else if (has_value && strcmp(argv[i], "--record") == 0) {
+			if (!world_system.record_input(argv[++i]))
+				return EXIT_FAILURE;
+			recorded = true;
+		}
+		else if (has_value && strcmp(argv[i], "--replay") == 0) {
+			if (!world_system.replay_input(argv[++i]))
+				return EXIT_FAILURE;
+			recorded = true;
+		}
+		else {
+			fprintf(stderr, "Unknown or incomplete option %s\n", argv[i]);
+			print_usage();
+			return EXIT_FAILURE;
+		}
+	}
+
 	// initialize the main systems
 	renderer_system.init(window);
-	world_system.init(&renderer_system);
+	world_system.init();
+	if (!ai_system.init()) {
+		std::cerr << "ERROR: Failed to load behavior trees." << std::endl;
+	}
+	// the AI frame budget depends on the CPU, recordings need every agent updated on the same tick
+	if (recorded)
+		ai_system.set_budget_us(INT_MAX);
+
+	Scheduler scheduler;
+	schedule_systems(scheduler, world_system, ai_system, physics_system);
 
-	// variable timestep loop
+	// from here on the render thread owns the GL context, the loop below only publishes snapshots to it
+	RenderMailbox& mailbox = renderer_system.get_mailbox();
+	renderer_system.start_thread();
+
+	// fixed timestep loop, sleeps until the next tick is due
 	auto t = Clock::now();
+	bool render_due = false;
+	bool snapshot_stale = true;
 	while (!world_system.is_over()) {
-		
+
 		// processes system messages, if this wasn't present the window would become unresponsive
 		glfwPollEvents();
 
@@ -53,13 +117,36 @@ int main()
 			(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
 		t = now;
 
-		// CK: be mindful of the order of your systems and rearrange this list only if necessary
-		world_system.step(elapsed_ms);
-		ai_system.step(elapsed_ms);
-		physics_system.step(elapsed_ms);
-		world_system.handle_collisions();
+		// the replay ends the game when it runs out
+		int ticks = run_frame(scheduler, world_system, elapsed_ms);
+		if (ticks < 0)
+			break;
+		snapshot_stale |= ticks > 0;
+
+		// while fast-forwarding only a few frames are drawn, and a snapshot is only captured when the state
+		// changed and the renderer took the previous one, i.e., at most one per displayed frame
+		FastForward& fast_forward = world_system.get_fast_forward();
+		render_due |= fast_forward.should_render(elapsed_ms);
+		if (render_due && snapshot_stale && mailbox.is_taken()) {
+			capture_render_snapshot(mailbox.back());
+			mailbox.publish();
+			render_due = snapshot_stale = false;
+		}
 
-		renderer_system.draw(elapsed_ms);
+		std::this_thread::sleep_for(std::chrono::microseconds((int)(fast_forward.ms_until_next_tick() * 1000)));
+	}
+	renderer_system.stop_thread();
+
+	unsigned int frames = renderer_system.get_frame_count();
+	if (frames > 0) {
+		const RenderStats& stats = renderer_system.get_total_stats();
+		printf("Rendered %u frames, per frame: %.1f draw calls, %.1f state changes, %.1f redundant binds skipped\n",
+			frames, (float)stats.draw_calls / frames, (float)stats.state_changes / frames, (float)stats.redundant / frames);
+	}
+	for (int i = 0; i < pool_count; i++) {
+		const PoolStats& pool = get_pool_stats((POOL_ID)i);
+		printf("%s pool: %u acquired, %u recycled, %u released, %u dropped\n",
+			get_pool_name((POOL_ID)i), pool.acquired, pool.hits, pool.released, pool.dropped);
 	}
 
 	return EXIT_SUCCESS;
@@ -0,0 +1,271 @@
+// stdlib
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+// internal
+#include "ai_system.hpp"
+#include "events.hpp"
+#include "physics_system.hpp"
+#include "systems.hpp"
+#include "random.hpp"
+#include "world_init.hpp"
+#include "world_system.hpp"
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Headless entry point, runs the game logic without window, rendering or audio as fast as the CPU allows
+namespace {
+	struct Options {
+		int ticks = 60 * 60;		// one minute of game time at 60 fps
+		float dt_ms = 1000.f / 60.f;
+		int towers = 0;
+		int invaders = 0;
+		int bench_ai = 0;			// > 0: only step the AI over this many agents
+		int ai_budget_us = 0;		// > 0: replaces the AI frame budget, which --bench-ai and recordings lift
+		bool serial = false;		// no lane sharding in the physics
+		bool until_wave_end = false;
+		const char* record = nullptr;
+		const char* replay = nullptr;
+		size_t pool_capacity[pool_count] = { PROJECTILE_POOL_SIZE, INVADER_POOL_SIZE, EXPLOSION_POOL_SIZE };
+	};
+
+	void print_usage()
+	{
+		fprintf(stderr,
+			"usage: tower_defense_headless [options]\n"
+			"  --ticks N       number of fixed steps to simulate (default 3600)\n"
+			"  --dt MS         milliseconds per step (default 16.67)\n"
+			"  --towers N      place N towers on the right, one per lane\n"
+			"  --invaders N    spawn N invaders on the left at the start\n"
+			"  --bench-ai N    benchmark the AI system alone with N agents\n"
+			"  --ai-budget US  microseconds of AI work per tick (default 1000, unlimited for --bench-ai)\n"
+			"  --serial        check collisions on one thread instead of per lane\n"
+			"  --until-wave-end  fast-forward through the first wave in frames of --dt, and check that\n"
+			"                  the clock stops within a tick of the wave end\n"
+			"  --pool NAME N   keep up to N dead projectile/invader/explosion entities for reuse\n"
+			"  --record FILE   save the seed and frame times to FILE\n"
+			"  --replay FILE   replay a recording of the game or of --record, ignores --ticks and --dt\n"
+			"                  (--towers and --invaders must match the recording)\n");
+	}
+
+	bool parse_options(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; i++) {
+			bool has_value = i + 1 < argc;
+			if (has_value && strcmp(argv[i], "--ticks") == 0)
+				options.ticks = atoi(argv[++i]);
+			else if (has_value && strcmp(argv[i], "--dt") == 0)
+				options.dt_ms = (float)atof(argv[++i]);
+			else if (has_value && strcmp(argv[i], "--towers") == 0)
+				options.towers = atoi(argv[++i]);
+			else if (has_value && strcmp(argv[i], "--invaders") == 0)
+				options.invaders = atoi(argv[++i]);
+			else if (has_value && strcmp(argv[i], "--bench-ai") == 0) {
+				// 0 would silently run the whole game instead
+				options.bench_ai = atoi(argv[++i]);
+				if (options.bench_ai <= 0) {
+					fprintf(stderr, "--bench-ai needs a positive number of agents, got %s\n", argv[i]);
+					return false;
+				}
+			}
+			else if (has_value && strcmp(argv[i], "--ai-budget") == 0)
+				options.ai_budget_us = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--serial") == 0)
+				options.serial = true;
+			else if (strcmp(argv[i], "--until-wave-end") == 0)
+				options.until_wave_end = true;
+			else if (i + 2 < argc && strcmp(argv[i], "--pool") == 0) {
+				POOL_ID pool;
+				if (!find_pool(argv[i + 1], pool))
+					return false;
+				options.pool_capacity[(int)pool] = (size_t)atoi(argv[i + 2]);
+				i += 2;
+			}
+			else if (has_value && strcmp(argv[i], "--record") == 0)
+				options.record = argv[++i];
+			else if (has_value && strcmp(argv[i], "--replay") == 0)
+				options.replay = argv[++i];
+			else {
+				fprintf(stderr, "Unknown or incomplete option %s\n", argv[i]);
+				return false;
+			}
+		}
+		return options.ticks > 0 && options.dt_ms > 0.f;
+	}
+
+	vec2 cell_center(int col, int row)
+	{
+		return { col * GRID_CELL_WIDTH_PX + GRID_CELL_WIDTH_PX / 2, row * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2 };
+	}
+
+	// the top row is kept free, as in the game
+	void place_towers(int count)
+	{
+		for (int i = 0; i < count && i < GRID_ROWS - 1; i++)
+			createTower(cell_center(GRID_COLS - 1, 1 + i));
+	}
+
+	void spawn_invaders(int count)
+	{
+		for (int i = 0; i < count; i++)
+			createInvader(cell_center(0, 1 + i % (GRID_ROWS - 1)), random_service.stream(i, RNG_PURPOSE::INVADER_TYPE).next_int(2));
+	}
+
+	// like the N key in the game: the frames run as many fixed ticks as the budget allows until the next wave
+	// starts, after which no tick may run, and certainly none with the length of a whole frame
+	int fast_forward_until_wave_end(Scheduler& scheduler, WorldSystem& world_system, const Options& options)
+	{
+		world_system.fast_forward_until_wave_end();
+		int wave = world_system.get_waves().get_wave();
+		int frames = 0;
+		while (world_system.get_fast_forward().is_on() && frames < options.ticks) {
+			run_frame(scheduler, world_system, options.dt_ms);
+			frames++;
+		}
+
+		const WaveScheduler& waves = world_system.get_waves();
+		float overshoot_ms = waves.get_wave_time_ms();
+		printf("Fast-forwarded from wave %d to wave %d in %d frames, %.2f ms into the new wave\n",
+			wave, waves.get_wave(), frames, overshoot_ms);
+		if (world_system.game_over || waves.get_wave() == wave) {
+			fprintf(stderr, "The wave did not end\n");
+			return EXIT_FAILURE;
+		}
+		if (overshoot_ms > SIM_TICK_MS) {
+			fprintf(stderr, "The clock ran %.2f ms past the wave end, more than one tick\n", overshoot_ms);
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	float us_since(Clock::time_point t)
+	{
+		return (float)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t).count();
+	}
+
+	// AI throughput: invaders spread over the field and a tower per lane, with an unlimited frame budget
+	int bench_ai(const Options& options)
+	{
+		AISystem ai_system;
+		if (!ai_system.init())
+			return EXIT_FAILURE;
+		ai_system.set_budget_us(options.ai_budget_us > 0 ? options.ai_budget_us : INT_MAX);
+
+		place_towers(GRID_ROWS - 1);
+		for (int i = 0; i < options.bench_ai; i++) {
+			int col = i % (GRID_COLS - 1);
+			int row = 1 + (i / (GRID_COLS - 1)) % (GRID_ROWS - 1);
+			createInvader(cell_center(col, row), i % 2);
+		}
+
+		float total_us = 0.f;
+		float max_us = 0.f;
+		unsigned int total_updated = 0;
+		for (int tick = 0; tick < options.ticks; tick++) {
+			ai_system.step(options.dt_ms);
+			ai_system.spawn_shots();
+			total_us += ai_system.get_stats().frame_us;
+			max_us = std::max(max_us, ai_system.get_stats().frame_us);
+			total_updated += ai_system.get_stats().agents_updated;
+		}
+
+		printf("AI benchmark: %d agents, %d ticks\n", (int)registry.aiAgents.size(), options.ticks);
+		printf("  %.1f us/tick (max %.1f), %.1f agents updated/tick, %.3f us/agent\n",
+			total_us / options.ticks, max_us,
+			(float)total_updated / options.ticks,
+			total_updated > 0 ? total_us / total_updated : 0.f);
+		return EXIT_SUCCESS;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage();
+		return EXIT_FAILURE;
+	}
+
+	if (options.bench_ai > 0)
+		return bench_ai(options);
+
+	// global systems
+	AISystem	  ai_system;
+	WorldSystem   world_system;
+	PhysicsSystem physics_system;
+
+	// the screen state is owned by the render system in the game
+	registry.screenStates.emplace(Entity());
+
+	if (options.record && !world_system.record_input(options.record))
+		return EXIT_FAILURE;
+	if (options.replay && !world_system.replay_input(options.replay))
+		return EXIT_FAILURE;
+
+	// initialize the main systems
+	world_system.start_and_load_sounds();
+	world_system.init();
+	if (!ai_system.init()) {
+		std::cerr << "ERROR: Failed to load behavior trees." << std::endl;
+		return EXIT_FAILURE;
+	}
+	// the AI frame budget depends on the CPU, recordings need every agent updated on the same tick
+	if (options.record || options.replay)
+		ai_system.set_budget_us(INT_MAX);
+	if (options.ai_budget_us > 0)
+		ai_system.set_budget_us(options.ai_budget_us);
+
+	physics_system.set_lane_sharding(!options.serial);
+	for (int i = 0; i < pool_count; i++)
+		set_pool_capacity((POOL_ID)i, options.pool_capacity[i]);
+	Scheduler scheduler;
+	schedule_systems(scheduler, world_system, ai_system, physics_system);
+
+	place_towers(options.towers);
+	spawn_invaders(options.invaders);
+
+	if (options.until_wave_end)
+		return fast_forward_until_wave_end(scheduler, world_system, options);
+
+	// fixed timestep loop, stops at game over, or replays the recorded steps until the recording ends
+	float game_ms = 0.f;
+	auto t_start = Clock::now();
+	int tick = 0;
+	for (;; tick++) {
+		float elapsed_ms = options.dt_ms;
+		if (world_system.is_replaying()) {
+			if (!world_system.next_replay_tick(elapsed_ms))
+				break;
+		}
+		else if (tick >= options.ticks || world_system.game_over || world_system.is_over()) {
+			break;
+		}
+		game_ms += elapsed_ms;
+
+		scheduler.run(elapsed_ms);
+	}
+	float total_ms = us_since(t_start) / 1000.f;
+
+	const AIStats& ai_stats = ai_system.get_stats();
+	printf("Simulated %d ticks (%.1f s of game time) in %.1f ms, %.0f ticks/s\n",
+		tick, game_ms / 1000.f, total_ms, total_ms > 0.f ? tick * 1000.f / total_ms : 0.f);
+	printf("  us per tick:");
+	for (const SystemTiming& timing : scheduler.get_timings())
+		printf(" %s %.1f", timing.name.c_str(), timing.runs > 0 ? timing.total_us / timing.runs : 0.f);
+	printf("\n");
+	printf("  points %u, game over %s\n", world_system.get_points(), world_system.game_over ? "yes" : "no");
+	printf("  invaders %d, towers %d, projectiles %d\n",
+		(int)registry.invaders.size(), (int)registry.towers.size(), (int)registry.projectiles.size());
+	printf("  ai budget overruns %u\n", ai_stats.budget_overruns);
+	printf("  events dropped: %u collision, %u damage\n", collision_events.get_dropped(), damage_events.get_dropped());
+
+	for (int i = 0; i < pool_count; i++) {
+		const PoolStats& pool = get_pool_stats((POOL_ID)i);
+		printf("  %s pool: %u acquired, %u recycled, %u released, %u dropped\n",
+			get_pool_name((POOL_ID)i), pool.acquired, pool.hits, pool.released, pool.dropped);
+	}
+
+	return EXIT_SUCCESS;
+}
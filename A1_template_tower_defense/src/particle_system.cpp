@@ -0,0 +1,138 @@
+// internal
+#include "particle_system.hpp"
+#include "simd.hpp"
+
+ParticlePool particle_pool(PARTICLE_CAPACITY);
+
+ParticlePool::ParticlePool(unsigned int capacity) :
+	position_x(capacity), position_y(capacity),
+	velocity_x(capacity), velocity_y(capacity),
+	life(capacity)
+{
+}
+
+bool ParticlePool::allocate(unsigned int count, unsigned int& first)
+{
+	const unsigned int size = (count + 3) / 4 * 4;
+	const unsigned int tail = ranges.empty() ? head : ranges.front().first;
+	const bool wrapped = !ranges.empty() && head <= tail;
+
+	if (size == 0 || size > capacity())
+		return false;
+
+	if (!wrapped && head + size > capacity()) {
+		// not enough room at the end, continue at the start and pad the end with a released range
+		if (size > tail)
+			return false;
+		if (head < capacity()) {
+			ranges.push_back({ head, capacity() - head, true });
+			used += capacity() - head;
+		}
+		head = 0;
+	}
+	else if (wrapped && head + size > tail) {
+		return false;
+	}
+
+	first = head;
+	ranges.push_back({ head, size, false });
+	head += size;
+	used += size;
+	return true;
+}
+
+void ParticlePool::release(unsigned int first)
+{
+	for (Range& range : ranges) {
+		if (range.first == first && !range.released) {
+			range.released = true;
+			break;
+		}
+	}
+
+	// the ring only frees up from its oldest end
+	while (!ranges.empty() && ranges.front().released) {
+		used -= ranges.front().size;
+		ranges.pop_front();
+	}
+	if (ranges.empty())
+		head = 0;
+}
+
+void ParticlePool::clear()
+{
+	ranges.clear();
+	head = 0;
+	used = 0;
+
+	std::lock_guard<std::mutex> lock(gpu_mutex);
+	gpu_spawns.clear();
+	gpu_generation++;
+}
+
+void ParticlePool::spawn_on_gpu(unsigned int first, unsigned int count, vec4 color)
+{
+	ParticleBurst burst;
+	burst.spawned_ms = gpu_time_ms;
+	burst.generation = gpu_generation;
+	burst.particles.resize(count);
+	for (unsigned int i = 0; i < count; i++) {
+		GpuParticle& particle = burst.particles[i];
+		particle.position = { position_x[first + i], position_y[first + i] };
+		particle.color = { color.r, color.g, color.b, life[first + i] };
+		particle.velocity = { velocity_x[first + i], velocity_y[first + i] };
+	}
+
+	std::lock_guard<std::mutex> lock(gpu_mutex);
+	gpu_spawns.push_back(std::move(burst));
+}
+
+void ParticlePool::take_gpu_spawns(double time_ms, unsigned int generation, std::vector<ParticleBurst>& bursts)
+{
+	std::lock_guard<std::mutex> lock(gpu_mutex);
+	while (!gpu_spawns.empty()) {
+		ParticleBurst& burst = gpu_spawns.front();
+		if (burst.generation == generation && burst.spawned_ms > time_ms)
+			break;
+		// generations only increase, a later one is not drawn yet
+		if (burst.generation > generation)
+			break;
+		if (burst.generation == generation)
+			bursts.push_back(std::move(burst));
+		gpu_spawns.pop_front();
+	}
+}
+
+unsigned int ParticlePool::update(unsigned int first, unsigned int count, float elapsed_ms)
+{
+	const float dt = elapsed_ms / 1000.f;
+	const simd::float4 step = simd::splat(dt);
+
+	float* px = position_x.data() + first;
+	float* py = position_y.data() + first;
+	const float* vx = velocity_x.data() + first;
+	const float* vy = velocity_y.data() + first;
+	float* l = life.data() + first;
+
+	// integrate, including the padding of the last group of 4
+	for (unsigned int i = 0; i < count; i += 4) {
+		simd::store(px + i, simd::load(px + i) + simd::load(vx + i) * step);
+		simd::store(py + i, simd::load(py + i) + simd::load(vy + i) * step);
+		simd::store(l + i, simd::load(l + i) - step);
+	}
+
+	// swap and pop dead particles within the range
+	for (unsigned int i = 0; i < count;) {
+		if (l[i] > 0.f) {
+			i++;
+			continue;
+		}
+		count--;
+		position_x[first + i] = position_x[first + count];
+		position_y[first + i] = position_y[first + count];
+		velocity_x[first + i] = velocity_x[first + count];
+		velocity_y[first + i] = velocity_y[first + count];
+		life[first + i] = life[first + count];
+	}
+	return count;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// stlib
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+
+// Particles spawned for the GPU simulation, with their initial state
+struct ParticleBurst {
+	std::vector<GpuParticle> particles;
+	double spawned_ms;			// ParticlePool::gpu_time_ms at the spawn
+	unsigned int generation;	// ParticlePool::gpu_generation at the spawn
+};
+
+// One engine-wide pool for all particles, stored as structure of arrays so that the update
+// runs 4 particles at a time (see simd.hpp). Emitters (e.g., Explosion) do not own particles,
+// they reference a contiguous range of the pool:
+// - allocate() hands out ranges from a ring, released ranges become free once all older ones are
+// - a range is padded to a multiple of 4, the update may touch the padding but never the next range
+// - dead particles are removed by moving the last live particle of the range into their slot
+// A particle's alpha is its remaining lifespan (1 second at birth), emitters hold the color.
+// With simulate_on_gpu, update() is not used: the renderer advances the particles on the GPU (see
+// RenderSystem::drawGpuParticles) to the simulated time of the snapshot it draws. The pool copies the initial
+// state of new ranges into bursts, which the render thread takes once it draws a snapshot as late as the spawn.
+class ParticlePool
+{
+public:
+	ParticlePool(unsigned int capacity);
+
+	// reserve room for 'count' particles, returns false if the pool is full
+	bool allocate(unsigned int count, unsigned int& first);
+	// return a range obtained from allocate()
+	void release(unsigned int first);
+	// release all ranges
+	void clear();
+
+	// advance the 'count' live particles starting at 'first', returns the number still alive
+	unsigned int update(unsigned int first, unsigned int count, float elapsed_ms);
+
+	unsigned int capacity() const { return (unsigned int)life.size(); }
+	unsigned int allocated() const { return used; }
+
+	std::vector<float> position_x, position_y;
+	std::vector<float> velocity_x, velocity_y;
+	std::vector<float> life;	// seconds left
+
+	bool simulate_on_gpu = false;
+	double gpu_time_ms = 0.0;			// simulated so far, advanced by the simulation
+	unsigned int gpu_generation = 0;	// increased by clear(), which drops all particles
+
+	// copies the initial state of the range to a burst, with the color of its emitter
+	void spawn_on_gpu(unsigned int first, unsigned int count, vec4 color);
+	// moves the bursts spawned in 'generation' until 'time_ms' to 'bursts', oldest first, and drops
+	// those of older generations. Called by the render thread.
+	void take_gpu_spawns(double time_ms, unsigned int generation, std::vector<ParticleBurst>& bursts);
+
+private:
+	struct Range {
+		unsigned int first;
+		unsigned int size;
+		bool released;
+	};
+
+	std::mutex gpu_mutex;
+	std::deque<ParticleBurst> gpu_spawns;	// oldest first, not taken yet
+
+	std::deque<Range> ranges;	// oldest first
+	unsigned int head = 0;		// next allocation, unless the ring wraps around
+	unsigned int used = 0;		// sum of all range sizes
+};
+
+extern ParticlePool particle_pool;
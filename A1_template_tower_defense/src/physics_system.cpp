@@ -1,6 +1,10 @@
 // internal
 #include "physics_system.hpp"
 #include "world_init.hpp"
+#include "influence_map.hpp"
+#include "job_system.hpp"
+#include "events.hpp"
+#include <algorithm>
 #include <iostream>
 
 // Returns the local bounding coordinates scaled by the current size of the entity
@@ -47,8 +51,27 @@ bool collides(const Motion& motion1, const Motion& motion2)
 
 }
 
+// Lane of the motion, or -1 if its box reaches into more than one lane (or none).
+// A box that just touches the next lane does not overlap anything in it, see collides().
+static int lane_of(const Motion& motion)
+{
+	vec2 half = get_bounding_box(motion) / 2.0f;
+	int top = (int)floor((motion.position.y - half.y) / GRID_CELL_HEIGHT_PX);
+	int bottom = (int)ceil((motion.position.y + half.y) / GRID_CELL_HEIGHT_PX) - 1;
+	if (top != bottom || top < 0 || top >= GRID_ROWS)
+		return -1;
+	return top;
+}
+
 void PhysicsSystem::step(float elapsed_ms)
 {
+	if (lane_sharding) {
+		step_by_lane(elapsed_ms);
+		collision_events.publish();
+		update_influence();
+		return;
+	}
+
 	// Move each entity that has motion (invaders, projectiles, and even towers [they have 0 for velocity])
 	// based on how much time has passed, this is to (partially) avoid
 	// having entities move at different speed based on the machine.
@@ -65,6 +88,8 @@ void PhysicsSystem::step(float elapsed_ms)
 		motion.position += motion.velocity * step_seconds;
 	}
 
+	update_influence();
+
 	// check for collisions between all moving entities
     ComponentContainer<Motion> &motion_container = registry.motions;
 	for(uint i = 0; i < motion_container.components.size(); i++)
@@ -79,14 +104,99 @@ void PhysicsSystem::step(float elapsed_ms)
 			if (collides(motion_i, motion_j))
 			{
 				Entity entity_j = motion_container.entities[j];
-				// Create a collisions event
-				// We are abusing the ECS system a bit in that we potentially insert muliple collisions for the same entity
-				// CK: why the duplication, except to allow searching by entity_id
-				registry.collisions.emplace_with_duplicates(entity_i, entity_j);
-				registry.collisions.emplace_with_duplicates(entity_j, entity_i);
-
-				// registry.collisions.emplace_with_duplicates(entity_j, entity_i);
+				// Create a collisions event, once per pair
+				collision_events.push({ entity_i, entity_j });
 			}
 		}
 	}
-}
\ No newline at end of file
+	collision_events.publish();
+}
+
+void PhysicsSystem::update_influence()
+{
+	// keep the influence map in sync, only invaders that changed cells touch the grid
+	for (uint i = 0; i < registry.invaders.size(); i++)
+	{
+		Invader& invader = registry.invaders.components[i];
+		const Motion& motion = registry.motions.get(registry.invaders.entities[i]);
+		if (InfluenceSnapshot::cell_of(motion.position) != invader.influence_cell)
+			invader.influence_cell = influence_map.move_invader(invader.influence_cell, motion.position);
+	}
+}
+
+void PhysicsSystem::step_lane(int l, float step_seconds)
+{
+	std::vector<Motion>& motions = registry.motions.components;
+	Lane& lane = lanes[l];
+	lane.pairs.clear();
+	lane.escaped.clear();
+
+	size_t stay = 0;
+	for (unsigned int i : lane.members) {
+		motions[i].position += motions[i].velocity * step_seconds;
+		if (lane_of(motions[i]) == l)
+			lane.members[stay++] = i;
+		else
+			lane.escaped.push_back(i);
+	}
+	lane.members.resize(stay);
+
+	for (size_t a = 0; a < lane.members.size(); a++)
+		for (size_t b = a + 1; b < lane.members.size(); b++)
+			if (collides(motions[lane.members[a]], motions[lane.members[b]]))
+				lane.pairs.push_back({ lane.members[a], lane.members[b] });
+}
+
+void PhysicsSystem::step_by_lane(float elapsed_ms)
+{
+	ComponentContainer<Motion>& motion_container = registry.motions;
+	std::vector<Motion>& motions = motion_container.components;
+	float step_seconds = elapsed_ms / 1000.f;
+
+	// sort the motions into lanes, in index order; everything spanning lanes is handled in the fix-up
+	for (Lane& lane : lanes)
+		lane.members.clear();
+	cross_lane.clear();
+	for (unsigned int i = 0; i < motions.size(); i++) {
+		int lane = lane_of(motions[i]);
+		if (lane >= 0)
+			lanes[lane].members.push_back(i);
+		else
+			cross_lane.push_back(i);
+	}
+
+	// one job per lane: move its motions, then check all pairs that are still within the lane
+	job_system.parallel_for(GRID_ROWS, 1, [&](size_t begin, size_t end) {
+		for (size_t lane = begin; lane < end; lane++)
+			step_lane((int)lane, step_seconds);
+	});
+
+	// fix-up: the few motions spanning lanes, or that left their lane, against everything
+	for (unsigned int i : cross_lane)
+		motions[i].position += motions[i].velocity * step_seconds;
+	for (const Lane& lane : lanes)
+		cross_lane.insert(cross_lane.end(), lane.escaped.begin(), lane.escaped.end());
+
+	std::vector<std::pair<unsigned int, unsigned int>>& pairs = fix_up_pairs;
+	pairs.clear();
+	for (size_t c = 0; c < cross_lane.size(); c++) {
+		unsigned int i = cross_lane[c];
+		for (const Lane& lane : lanes)
+			for (unsigned int j : lane.members)
+				if (collides(motions[i], motions[j]))
+					pairs.push_back({ std::min(i, j), std::max(i, j) });
+		for (size_t d = c + 1; d < cross_lane.size(); d++)
+			if (collides(motions[i], motions[cross_lane[d]]))
+				pairs.push_back({ std::min(i, cross_lane[d]), std::max(i, cross_lane[d]) });
+	}
+
+	// report the collisions in the order of the serial loop, so both modes play out identically
+	for (const Lane& lane : lanes)
+		pairs.insert(pairs.end(), lane.pairs.begin(), lane.pairs.end());
+	std::sort(pairs.begin(), pairs.end());
+	for (const std::pair<unsigned int, unsigned int>& pair : pairs) {
+		Entity entity_i = motion_container.entities[pair.first];
+		Entity entity_j = motion_container.entities[pair.second];
+		collision_events.push({ entity_i, entity_j });
+	}
+}
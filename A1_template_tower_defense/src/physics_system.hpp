@@ -1,17 +1,45 @@
 #pragma once
 
+#include <array>
+#include <utility>
+#include <vector>
+
 #include "common.hpp"
 #include "tinyECS/tiny_ecs.hpp"
 #include "tinyECS/components.hpp"
 #include "tinyECS/registry.hpp"
 
 // A simple physics system that moves rigid bodies and checks for collision
+// With lane sharding (the default), invaders, towers and projectiles are split by the row they are in, since they
+// only ever interact within it. Each lane is moved and checked for collisions as an independent job (see
+// job_system.hpp). Motions that span several lanes, or left theirs during the step, are checked against all
+// others in a serial fix-up. The collisions are reported in the same order as without sharding.
 class PhysicsSystem
 {
 public:
 	void step(float elapsed_ms);
 
+	void set_lane_sharding(bool lane_sharding) { this->lane_sharding = lane_sharding; }
+
 	PhysicsSystem()
 	{
 	}
+
+private:
+	void update_influence();
+	void step_by_lane(float elapsed_ms);
+	// moves the motions of one lane, then checks them for collisions
+	void step_lane(int lane, float step_seconds);
+
+	bool lane_sharding = true;
+
+	// per lane, reused every step
+	struct Lane {
+		std::vector<unsigned int> members;		// motion indices, ascending
+		std::vector<unsigned int> escaped;		// members that moved out of the lane
+		std::vector<std::pair<unsigned int, unsigned int>> pairs;	// colliding motion indices, first < second
+	};
+	std::array<Lane, GRID_ROWS> lanes;
+	std::vector<unsigned int> cross_lane;
+	std::vector<std::pair<unsigned int, unsigned int>> fix_up_pairs;
 };
\ No newline at end of file
@@ -0,0 +1,4 @@
+// internal
+#include "random.hpp"
+
+RandomService random_service;
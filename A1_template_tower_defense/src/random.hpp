@@ -0,0 +1,86 @@
+#pragma once
+
+// stlib
+#include <cstddef>
+#include <cstdint>
+
+// What a stream of random numbers is drawn for, so two draws for the same entity on the same tick
+// (e.g., an invader's type and its explosion) never see the same numbers
+enum class RNG_PURPOSE : uint32_t {
+	INVADER_TYPE = 0,
+	EXPLOSION = INVADER_TYPE + 1,
+	WAVE_SPAWN = EXPLOSION + 1,
+	PURPOSE_COUNT = WAVE_SPAWN + 1
+};
+
+// SplitMix64 finalizer, a bijective mix of all 64 bits
+inline uint64_t splitmix64(uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+// Counter-based random numbers: the n-th number of a stream is splitmix64(key + n * 0x9E3779B97F4A7C15), nothing else.
+// A stream is identified by (seed, tick, key, purpose) where key is usually an entity id, so any
+// system or thread can create its own stream on the stack and gets the same numbers in every run,
+// regardless of the order in which streams are created or used. Streams are cheap to copy.
+class RandomStream
+{
+public:
+	RandomStream(uint64_t seed, uint32_t tick, uint32_t key, RNG_PURPOSE purpose)
+	{
+		uint64_t k = splitmix64(seed);
+		k = splitmix64(k ^ ((uint64_t)tick << 32 | key));
+		this->key = splitmix64(k ^ (uint64_t)purpose);
+	}
+
+	uint64_t next_u64() { return at(counter++); }
+	uint32_t next_u32() { return (uint32_t)(next_u64() >> 32); }
+	// uniform in [0, 1)
+	float next_float() { return to_float(next_u64()); }
+	// uniform in [lo, hi)
+	float next_float(float lo, float hi) { return lo + (hi - lo) * next_float(); }
+	// uniform in [0, n), n > 0
+	int next_int(int n) { return (int)(((uint64_t)next_u32() * (uint64_t)n) >> 32); }
+
+	// batch fill for particle bursts, out[i] is uniform in [lo, hi).
+	// Each value only depends on its counter, the loop has no dependency between iterations.
+	void fill(float* out, size_t count, float lo, float hi)
+	{
+		const float range = hi - lo;
+		for (size_t i = 0; i < count; i++)
+			out[i] = lo + range * to_float(at(counter + i));
+		counter += count;
+	}
+
+private:
+	uint64_t at(uint64_t n) const { return splitmix64(key + n * 0x9E3779B97F4A7C15ull); }
+	// top 24 bits, exactly representable
+	static float to_float(uint64_t x) { return (float)(x >> 40) * (1.f / 16777216.f); }
+
+	uint64_t key;
+	uint64_t counter = 0;
+};
+
+// The game's seed and tick. Set by the world between steps, read-only while systems run,
+// so streams can be created from any thread.
+class RandomService
+{
+public:
+	void set_seed(uint64_t seed) { this->seed = seed; }
+	uint64_t get_seed() const { return seed; }
+
+	void set_tick(uint32_t tick) { this->tick = tick; }
+	uint32_t get_tick() const { return tick; }
+
+	// stream of the current tick
+	RandomStream stream(uint32_t key, RNG_PURPOSE purpose) const { return RandomStream(seed, tick, key, purpose); }
+
+private:
+	uint64_t seed = 0;
+	uint32_t tick = 0;
+};
+
+extern RandomService random_service;
@@ -0,0 +1,43 @@
+// internal
+#include "render_queue.hpp"
+
+// stlib
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+uint64_t render_sort_key(RENDER_LAYER layer, EFFECT_ASSET_ID effect, unsigned int texture, GEOMETRY_BUFFER_ID geometry, float depth)
+{
+	assert((int)layer < 16 && (int)effect < 16 && texture < 256 && (int)geometry < 16);
+	uint64_t quantized_depth = (uint64_t)(std::min(std::max(depth, 0.f), 1.f) * 0xFFFF);
+	return (uint64_t)layer << 60 | (uint64_t)effect << 56 | (uint64_t)texture << 48 | (uint64_t)geometry << 44
+		| quantized_depth;
+}
+
+void RenderQueue::sort()
+{
+	if (packets.empty())
+		return;
+	sorted.resize(packets.size());
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		std::array<size_t, 256> offsets = {};
+		for (const RenderPacket& packet : packets)
+			offsets[(packet.key >> shift) & 0xFF]++;
+
+		// all keys share this byte (e.g., the unused bits), the pass would not move anything
+		if (offsets[(packets[0].key >> shift) & 0xFF] == packets.size())
+			continue;
+
+		// counts to the first position of each byte value
+		size_t offset = 0;
+		for (size_t& count : offsets) {
+			size_t first = offset;
+			offset += count;
+			count = first;
+		}
+		for (const RenderPacket& packet : packets)
+			sorted[offsets[(packet.key >> shift) & 0xFF]++] = packet;
+		packets.swap(sorted);
+	}
+}
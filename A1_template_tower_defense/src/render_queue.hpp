@@ -0,0 +1,41 @@
+#pragma once
+
+// stlib
+#include <cstdint>
+#include <vector>
+
+#include "tinyECS/components.hpp"
+
+// The draw of one snapshot item. The key orders the draws, most significant first: render layer (4 bits),
+// effect (4 bits), texture (8 bits), geometry (4 bits), 28 unused bits and the depth (16 bits).
+// Packets whose keys only differ in the depth need the same GL state and are drawn as one batch.
+struct RenderPacket {
+	uint64_t key;
+	unsigned int index;	// of the item in RenderSnapshot::items, not of the entity in registry.renderRequests
+};
+
+// 'texture' is the GL texture object the draw binds, as an index of the renderer's textures (0: none).
+// 'depth' is in [0, 1], farther back is drawn first.
+uint64_t render_sort_key(RENDER_LAYER layer, EFFECT_ASSET_ID effect, unsigned int texture, GEOMETRY_BUFFER_ID geometry, float depth);
+
+// the GL state selected by a key, equal for the packets of a batch
+inline uint64_t render_state_of(uint64_t key) { return key >> 16; }
+
+inline RENDER_LAYER render_layer_of(uint64_t key) { return (RENDER_LAYER)(key >> 60); }
+
+// The packets of one frame, sorted by key
+class RenderQueue
+{
+public:
+	void clear() { packets.clear(); }
+	void push(uint64_t key, unsigned int index) { packets.push_back({ key, index }); }
+
+	// least significant digit radix sort, a byte per pass, packets with equal keys stay in push order
+	void sort();
+
+	const std::vector<RenderPacket>& get_packets() const { return packets; }
+
+private:
+	std::vector<RenderPacket> packets;
+	std::vector<RenderPacket> sorted;	// the target of a pass
+};
@@ -0,0 +1,98 @@
+// internal
+#include "render_snapshot.hpp"
+#include "particle_system.hpp"
+#include "tinyECS/registry.hpp"
+
+// stlib
+#include <glm/trigonometric.hpp>
+#include <utility>
+
+void capture_render_snapshot(RenderSnapshot& snapshot)
+{
+	snapshot.items.clear();
+	const std::vector<Entity>& entities = registry.renderRequests.entities;
+	for (unsigned int i = 0; i < entities.size(); i++) {
+		Entity entity = entities[i];
+		RenderItem item;
+		item.request = registry.renderRequests.components[i];
+		item.entity_id = entity.id();
+
+		// Transformation code, see Rendering and Transformation in the template
+		// specification for more info Incrementally updates transformation matrix,
+		// thus ORDER IS IMPORTANT
+		// lower on the screen is in front, grid lines do not have motion but need to be rendered
+		Transform transform;
+		if (registry.motions.has(entity)) {
+			const Motion& motion = registry.motions.get(entity);
+			transform.translate(motion.position);
+			transform.scale(motion.scale);
+			transform.rotate(radians(motion.angle));
+			item.depth = motion.position.y / WINDOW_HEIGHT_PX;
+		}
+		else if (registry.gridLines.has(entity)) {
+			const GridLine& grid_line = registry.gridLines.get(entity);
+			transform.translate(grid_line.start_pos);
+			transform.scale(grid_line.end_pos);
+			item.depth = 0.f;
+		}
+		else {
+			continue;
+		}
+		item.transform = transform.mat;
+		item.color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+		snapshot.items.push_back(item);
+	}
+
+	// particles fade out over their lifespan
+	snapshot.particles.clear();
+	if (!particle_pool.simulate_on_gpu) {
+		for (const Explosion& explosion : registry.explosions.components) {
+			for (unsigned int i = explosion.first; i < explosion.first + explosion.count; i++) {
+				snapshot.particles.push_back({ { particle_pool.position_x[i], particle_pool.position_y[i] },
+					{ explosion.color.r, explosion.color.g, explosion.color.b, particle_pool.life[i] } });
+			}
+		}
+	}
+	snapshot.gpu_particle_time_ms = particle_pool.gpu_time_ms;
+	snapshot.gpu_particle_generation = particle_pool.gpu_generation;
+
+	const ScreenState& screen = registry.screenStates.components[0];
+	snapshot.darken_screen_factor = screen.darken_screen_factor;
+	snapshot.vignette_intensity = screen.vignette_intensity;
+}
+
+void RenderMailbox::publish()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::swap(back_index, latest_index);
+		fresh = true;
+	}
+	published.notify_one();
+}
+
+bool RenderMailbox::is_taken()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return !fresh;
+}
+
+const RenderSnapshot* RenderMailbox::take()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	published.wait(lock, [this]() { return fresh || closed; });
+	if (closed)
+		return nullptr;
+	std::swap(front_index, latest_index);
+	fresh = false;
+	return &snapshots[front_index];
+}
+
+void RenderMailbox::close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+	}
+	published.notify_one();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// stlib
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+
+// The draw of one entity, as the renderer needs it
+struct RenderItem {
+	RenderRequest request;
+	mat3 transform;
+	vec3 color;
+	float depth;				// in [0, 1], farther back is drawn first
+	unsigned int entity_id;
+};
+
+// Everything the renderer draws in one frame, copied from the registry by the simulation thread. Once
+// published it is immutable, the render thread draws it while the simulation advances.
+struct RenderSnapshot {
+	std::vector<RenderItem> items;
+	std::vector<ParticleVertex> particles;	// the particles simulated on the CPU
+	double gpu_particle_time_ms = 0.0;		// the particles simulated on the GPU, see ParticlePool
+	unsigned int gpu_particle_generation = 0;
+	float darken_screen_factor = 0.f;
+	float vignette_intensity = 0.f;
+};
+
+// fills 'snapshot' with the current state of the registry and the particle pool
+void capture_render_snapshot(RenderSnapshot& snapshot);
+
+// Hands the latest snapshot from the simulation to the render thread, neither waits for the other. Of the
+// three snapshots, the simulation writes one, one is the latest published and the renderer draws one.
+// Publishing replaces the latest one, if the renderer did not take it yet it is dropped.
+class RenderMailbox
+{
+public:
+	// the snapshot to fill before the next publish()
+	RenderSnapshot& back() { return snapshots[back_index]; }
+	void publish();
+	// whether the renderer took the last published snapshot, publishing before that would drop it
+	bool is_taken();
+
+	// waits for a snapshot published after the last one taken, returns nullptr once closed
+	const RenderSnapshot* take();
+	void close();
+
+private:
+	std::array<RenderSnapshot, 3> snapshots;
+	unsigned int back_index = 0;
+	unsigned int latest_index = 1;
+	unsigned int front_index = 2;	// taken by the renderer
+	bool fresh = false;				// latest_index was published since the last take()
+	bool closed = false;
+	std::mutex mutex;
+	std::condition_variable published;
+};
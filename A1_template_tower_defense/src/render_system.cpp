@@ -1,275 +1,303 @@
 
 #include <SDL.h>
-#include <glm/trigonometric.hpp>
+#include <cstring>
 #include <iostream>
 
 // internal
 #include "render_system.hpp"
-#include "tinyECS/registry.hpp"
+#include "particle_system.hpp"
 
-void RenderSystem::drawGridLine(Entity entity,
-								const mat3& projection) {
-
-	GridLine& gridLine = registry.gridLines.get(entity);
-
-	// Transformation code, see Rendering and Transformation in the template
-	// specification for more info Incrementally updates transformation matrix,
-	// thus ORDER IS IMPORTANT
-	Transform transform;
-	transform.translate(gridLine.start_pos);
-	transform.scale(gridLine.end_pos);
-
-	assert(registry.renderRequests.has(entity));
-	const RenderRequest& render_request = registry.renderRequests.get(entity);
-
-	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
-	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const GLuint program = (GLuint)effects[used_effect_enum];
+GLsizei RenderSystem::bindGeometry(GEOMETRY_BUFFER_ID geometry)
+{
+	assert(geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
+	gl_state.bind_vertex_array(vertex_arrays[(GLuint)geometry]);
+	return index_counts[(GLuint)geometry];
+}
 
-	// setting shaders
-	glUseProgram(program);
-	//gl_has_errors;
+void RenderSystem::drawMesh(const RenderItem& item, const mat3& projection)
+{
+	const RenderRequest& render_request = item.request;
+	assert(render_request.used_effect != EFFECT_ASSET_ID::EFFECT_COUNT);
+	const Effect& effect = effects[(GLuint)render_request.used_effect];
 
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
+	// Setting shaders
+	gl_state.use_program(effect.program);
 
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	//gl_has_errors;
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	//gl_has_errors;
+	GLsizei num_indices = bindGeometry(render_request.used_geometry);
 
-	if (render_request.used_effect == EFFECT_ASSET_ID::EGG)
+	// texture-mapped entities, the animation frame is chosen by the world (see WorldSystem::step_animations)
+	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED)
 	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		//gl_has_errors;
-
-		GLint in_color_loc    = glGetAttribLocation(program, "in_color");
-		//gl_has_errors;
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-			sizeof(ColoredVertex), (void*)0);
-		//gl_has_errors;
-
-		glEnableVertexAttribArray(in_color_loc);
-		glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE,
-			sizeof(ColoredVertex), (void*)sizeof(vec3));
+		// Binding texture to slot 0
+		assert(render_request.used_texture != TEXTURE_ASSET_ID::TEXTURE_COUNT);
+		gl_state.bind_texture(GL_TEXTURE_2D_ARRAY, texture_array);
+		glUniform3fv(effect.layer, 1, (float*)&texture_layers[(GLuint)render_request.used_texture]);
 		//gl_has_errors;
 	}
-	else
+	// .obj entities and grid lines only need their vertex array, the vertices carry the color
+	else if (render_request.used_effect != EFFECT_ASSET_ID::CHICKEN && render_request.used_effect != EFFECT_ASSET_ID::EGG)
 	{
 		assert(false && "Type of render request not supported");
 	}
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	// CK: std::cout << "line color: " << color.r << ", " << color.g << ", " << color.b << std::endl;
-	glUniform3fv(color_uloc, 1, (float*)&color);
-	//gl_has_errors;
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	//gl_has_errors;
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
-	//gl_has_errors;
-
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
+	glUniform3fv(effect.fcolor, 1, (float *)&item.color);
+	glUniformMatrix3fv(effect.transform, 1, GL_FALSE, (float *)&item.transform);
+	glUniformMatrix3fv(effect.projection, 1, GL_FALSE, (float *)&projection);
 	//gl_has_errors;
 
 	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	gl_state.draw_elements(GL_TRIANGLES, num_indices);
 	//gl_has_errors;
 }
 
-void RenderSystem::drawTexturedMesh(Entity entity,
-									const mat3 &projection,
-									float elapsed_ms)
+void RenderSystem::addSprite(const RenderItem& item)
 {
-	Motion &motion = registry.motions.get(entity);
-	// Transformation code, see Rendering and Transformation in the template
-	// specification for more info Incrementally updates transformation matrix,
-	// thus ORDER IS IMPORTANT
-	Transform transform;
-	transform.translate(motion.position);
-	transform.scale(motion.scale);
-	transform.rotate(radians(motion.angle));
-
-	assert(registry.renderRequests.has(entity));
-	const RenderRequest &render_request = registry.renderRequests.get(entity);
-
-	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
-	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const GLuint program = (GLuint)effects[used_effect_enum];
-
-	// Setting shaders
-	glUseProgram(program);
-	//gl_has_errors;
-
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
-
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-
-    GLuint texture_id = texture_gl_handles[(GLuint)render_request.used_texture];
+	assert(item.request.used_texture != TEXTURE_ASSET_ID::TEXTURE_COUNT);
 
+	SpriteInstance instance;
+	instance.transform = item.transform;
+	instance.color = item.color;
+	instance.layer = texture_layers[(GLuint)item.request.used_texture];
+	sprite_instances.push_back(instance);
+}
 
-	// for walking animation
-	if (registry.animations.has(entity)) {
-		Animation& animation = registry.animations.get(entity);
-		animation.elapsed_time += ((float)glfwGetTime()) * elapsed_ms;
+void RenderSystem::queueRenderPackets(const std::vector<RenderItem>& items)
+{
+	render_queue.clear();
+	for (unsigned int i = 0; i < items.size(); i++) {
+		const RenderRequest& render_request = items[i].request;
+		assert(render_request.layer != RENDER_LAYER::LAYER_COUNT);
+
+		// all sprite textures are layers of the texture array, they don't split batches
+		const unsigned int texture = render_request.used_texture == TEXTURE_ASSET_ID::TEXTURE_COUNT ? 0 : 1;
+		render_queue.push(render_sort_key(render_request.layer, render_request.used_effect, texture,
+			render_request.used_geometry, items[i].depth), i);
+	}
+	render_queue.sort();
+}
 
-		if (animation.elapsed_time >= animation.frame_duration) {
-			animation.current_frame = (animation.current_frame + 1) % animation.total_frames;
-			animation.elapsed_time = 0;
-		}
-        texture_id = texture_gl_handles[animation.current_frame];
+void RenderSystem::drawPackets(const std::vector<RenderItem>& items, const RenderPacket* packets, size_t count, const mat3& projection)
+{
+	for (size_t begin = 0, end = 0; begin < count; begin = end) {
+		const uint64_t state = render_state_of(packets[begin].key);
+		for (end = begin + 1; end < count && render_state_of(packets[end].key) == state; end++);
+		drawBatch(items, packets + begin, end - begin, projection);
+	}
+}
 
+void RenderSystem::drawBatch(const std::vector<RenderItem>& items, const RenderPacket* packets, size_t count, const mat3& projection)
+{
+	const RenderRequest& render_request = items[packets[0].index].request;
+
+	// textured sprites are drawn instanced
+	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED && render_request.used_geometry == GEOMETRY_BUFFER_ID::SPRITE) {
+		for (size_t i = 0; i < count; i++)
+			addSprite(items[packets[i].index]);
+		drawSprites(projection);
+		return;
 	}
 
-	// texture-mapped entities - use data location as in the vertex buffer
-	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED)
-	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		//gl_has_errors;
-		assert(in_texcoord_loc >= 0);
+	// the others one by one, the state is only set for the first
+	for (size_t i = 0; i < count; i++)
+		drawMesh(items[packets[i].index], projection);
+}
 
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-							  sizeof(TexturedVertex), (void *)0);
-		//gl_has_errors;
+// draws the sprites collected by addSprite, in one instanced draw call
+void RenderSystem::drawSprites(const mat3& projection)
+{
+	if (sprite_instances.empty())
+		return;
 
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-			(void *)sizeof(
-				vec3)); // note the stride to skip the preceeding vertex position
+	const Effect& effect = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED_INSTANCED];
+	gl_state.use_program(effect.program);
 
-		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		//gl_has_errors;
+	// the quad, shared by all instances
+	gl_state.bind_vertex_array(sprite_instance_vertex_array);
+	const GLsizei num_indices = index_counts[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
 
-		assert(registry.renderRequests.has(entity));
-		GLuint texture_id =
-			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
+	// orphan last frame's storage, so that the upload does not wait for draws still using it
+	gl_state.bind_array_buffer(sprite_instance_buffer);
+	const GLsizeiptr instance_bytes = sizeof(SpriteInstance) * sprite_instances.size();
+	glBufferData(GL_ARRAY_BUFFER, instance_bytes, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instance_bytes, sprite_instances.data());
 
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		//gl_has_errors;
-	}
-	// .obj entities
-	else if (render_request.used_effect == EFFECT_ASSET_ID::CHICKEN || render_request.used_effect == EFFECT_ASSET_ID::EGG)
-	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_color_loc = glGetAttribLocation(program, "in_color");
-		//gl_has_errors;
+	glUniformMatrix3fv(effect.projection, 1, GL_FALSE, (float*)&projection);
+	gl_state.bind_texture(GL_TEXTURE_2D_ARRAY, texture_array);
+	gl_state.draw_elements_instanced(GL_TRIANGLES, num_indices, (GLsizei)sprite_instances.size());
 
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-							  sizeof(ColoredVertex), (void *)0);
-		//gl_has_errors;
+	sprite_instances.clear();
+}
 
-		glEnableVertexAttribArray(in_color_loc);
-		glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE,
-							  sizeof(ColoredVertex), (void *)sizeof(vec3));
-		//gl_has_errors;
-	}
-	else
-	{
-		assert(false && "Type of render request not supported");
+// FNV-1a, over everything the draws of the packets depend on
+static uint64_t packetSignature(const std::vector<RenderItem>& items, const RenderPacket* packets, size_t count)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const void* data, size_t size) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= ((const unsigned char*)data)[i];
+			hash *= 1099511628211ull;
+		}
+	};
+	for (size_t i = 0; i < count; i++) {
+		const RenderItem& item = items[packets[i].index];
+		add(&packets[i].key, sizeof(packets[i].key));
+		add(&item.entity_id, sizeof(item.entity_id));
+		add(&item.transform, sizeof(item.transform));
+		add(&item.color, sizeof(item.color));
 	}
+	return hash;
+}
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	//gl_has_errors;
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	//gl_has_errors;
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	//gl_has_errors;
+void RenderSystem::updateStaticLayer(const std::vector<RenderItem>& items, const RenderPacket* packets, size_t count, const mat3& projection)
+{
+	const uint64_t signature = packetSignature(items, packets, count);
+	if (signature == static_layer_signature)
+		return;
+	static_layer_signature = signature;
 
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	//gl_has_errors;
+	// the white background, then the static packets, as the frame used to start
+	gl_state.bind_framebuffer(static_layer_frame_buffer);
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	drawPackets(items, packets, count, projection);
+}
 
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	//gl_has_errors;
+void RenderSystem::drawStaticLayer()
+{
+	const Effect& effect = effects[(GLuint)EFFECT_ASSET_ID::COMPOSITE];
+	gl_state.use_program(effect.program);
+	GLsizei num_indices = bindGeometry(GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE);
+	gl_state.bind_texture(GL_TEXTURE_2D, static_layer_texture);
 
+	// opaque, it replaces the background
+	glDisable(GL_BLEND);
+	gl_state.draw_elements(GL_TRIANGLES, num_indices);
+	glEnable(GL_BLEND);
 }
 
 //render all the particles using the particle shader
-void RenderSystem::drawParticles(const Explosion& explosion, const mat3& projection) {
-
-	GLuint program = effects[(GLuint)EFFECT_ASSET_ID::PARTICLE];
-	glUseProgram(program);
+void RenderSystem::drawParticles(const std::vector<ParticleVertex>& particles, const mat3& projection) {
+
+	const GLsizei count = (GLsizei)particles.size();
+	if (count == 0)
+		return;
+
+	// continue the ring after the last frame's vertices, the draws still reading them are not waited for
+	gl_state.bind_array_buffer(particle_buffer);
+	const GLsizeiptr bytes = sizeof(ParticleVertex) * count;
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	if (particle_buffer_offset + bytes > (GLsizeiptr)sizeof(ParticleVertex) * particle_pool.capacity()) {
+		particle_buffer_offset = 0;
+		access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;	// orphans the storage
+	}
+	ParticleVertex* vertices = (ParticleVertex*)glMapBufferRange(GL_ARRAY_BUFFER, particle_buffer_offset, bytes, access);
+	if (vertices == nullptr) {
+		fprintf(stderr, "Failed to map the particle buffer\n");
+		return;
+	}
+	memcpy(vertices, particles.data(), bytes);
+	glUnmapBuffer(GL_ARRAY_BUFFER);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	const Effect& effect = effects[(GLuint)EFFECT_ASSET_ID::PARTICLE];
+	gl_state.use_program(effect.program);
+	gl_state.bind_vertex_array(particle_vertex_array);
+	glUniformMatrix3fv(effect.projection, 1, GL_FALSE, (float*)&projection);
+	glUniform1f(effect.point_size, 10.0f);
+	gl_state.draw_arrays(GL_POINTS, (GLint)(particle_buffer_offset / sizeof(ParticleVertex)), count);
 
-	for (const auto& particle : explosion.particles) {
-		Transform transform;
-		transform.translate(particle.position);
-		transform.scale({5.0f, 5.0f});
-		
-		GLint transform_loc = glGetUniformLocation(program, "transform");
-		glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float*)&transform.mat);
+	particle_buffer_offset += bytes;
+}
 
-		GLint projection_loc = glGetUniformLocation(program, "projection");
-        glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float*)&projection);
+void RenderSystem::drawGpuParticles(const RenderSnapshot& snapshot, const mat3& projection)
+{
+	// a restart dropped all particles
+	if (snapshot.gpu_particle_generation != gpu_particle_generation) {
+		gpu_bursts.clear();
+		gpu_particle_count = 0;
+		gpu_particle_generation = snapshot.gpu_particle_generation;
+		gpu_particle_time_ms = snapshot.gpu_particle_time_ms;
+	}
 
-        GLint color_loc = glGetUniformLocation(program, "color");
-        glUniform4fv(color_loc, 1, (float*)&particle.color);
+	// advance the particles to the time of the snapshot, the dead bursts are left behind
+	const float elapsed = (float)(snapshot.gpu_particle_time_ms - gpu_particle_time_ms) / 1000.f;
+	gpu_particle_time_ms = snapshot.gpu_particle_time_ms;
+	if (elapsed > 0.f && gpu_particle_count > 0) {
+		unsigned int dead = 0;
+		for (GpuBurst& burst : gpu_bursts)
+			burst.life -= elapsed;
+		while (!gpu_bursts.empty() && gpu_bursts.front().life <= 0.f) {
+			dead += gpu_bursts.front().count;
+			gpu_bursts.pop_front();
+		}
 
-		GLint size_loc = glGetUniformLocation(program, "point_size");
-        glUniform1f(size_loc, 10.0f); 
+		const unsigned int target = 1 - gpu_particle_source;
+		const unsigned int live = gpu_particle_count - dead;
+		if (live > 0) {
+			const Effect& effect = effects[(GLuint)EFFECT_ASSET_ID::PARTICLE_UPDATE];
+			gl_state.use_program(effect.program);
+			gl_state.bind_vertex_array(gpu_particle_vertex_arrays[gpu_particle_source]);
+			glUniform1f(effect.elapsed, elapsed);
+
+			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, gpu_particle_buffers[target]);
+			glEnable(GL_RASTERIZER_DISCARD);
+			glBeginTransformFeedback(GL_POINTS);
+			gl_state.draw_arrays(GL_POINTS, (GLint)dead, (GLsizei)live);
+			glEndTransformFeedback();
+			glDisable(GL_RASTERIZER_DISCARD);
+		}
+		gpu_particle_source = target;
+		gpu_particle_count = live;
+	}
 
-		glEnable(GL_PROGRAM_POINT_SIZE);
-        glDrawArrays(GL_POINTS, 0, 1);
+	// append the bursts spawned until the snapshot, aged by the time simulated after their spawn
+	gpu_spawns.clear();
+	particle_pool.take_gpu_spawns(snapshot.gpu_particle_time_ms, snapshot.gpu_particle_generation, gpu_spawns);
+	gpu_spawn_upload.clear();
+	for (const ParticleBurst& burst : gpu_spawns) {
+		const float age = (float)(snapshot.gpu_particle_time_ms - burst.spawned_ms) / 1000.f;
+		const float life = burst.particles[0].color.a - age;
+		if (life <= 0.f || gpu_particle_count + gpu_spawn_upload.size() + burst.particles.size() > particle_pool.capacity())
+			continue;
+		for (GpuParticle particle : burst.particles) {
+			particle.position += particle.velocity * age;
+			particle.color.a = life;
+			gpu_spawn_upload.push_back(particle);
+		}
+		gpu_bursts.push_back({ (unsigned int)burst.particles.size(), life });
+	}
+	if (!gpu_spawn_upload.empty()) {
+		gl_state.bind_array_buffer(gpu_particle_buffers[gpu_particle_source]);
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof(GpuParticle) * gpu_particle_count,
+			sizeof(GpuParticle) * gpu_spawn_upload.size(), gpu_spawn_upload.data());
+		gpu_particle_count += (unsigned int)gpu_spawn_upload.size();
 	}
+
+	if (gpu_particle_count == 0)
+		return;
+
+	const Effect& effect = effects[(GLuint)EFFECT_ASSET_ID::PARTICLE];
+	gl_state.use_program(effect.program);
+	gl_state.bind_vertex_array(gpu_particle_vertex_arrays[gpu_particle_source]);
+	glUniformMatrix3fv(effect.projection, 1, GL_FALSE, (float*)&projection);
+	glUniform1f(effect.point_size, 10.0f);
+	gl_state.draw_arrays(GL_POINTS, 0, (GLsizei)gpu_particle_count);
 }
 
 // first draw to an intermediate texture,
 // apply the "vignette" texture, when requested
 // then draw the intermediate texture
-void RenderSystem::drawToScreen()
+void RenderSystem::drawToScreen(const RenderSnapshot& snapshot)
 {
 	// Setting shaders
 	// get the vignette texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::VIGNETTE]);
-	//gl_has_errors;
+	const Effect& vignette = effects[(GLuint)EFFECT_ASSET_ID::VIGNETTE];
+	gl_state.use_program(vignette.program);
 
 	// Clearing backbuffer
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	gl_state.bind_framebuffer(0);
 	glViewport(0, 0, w, h);
 	glDepthRange(0, 10);
 	glClearColor(1.f, 0, 0, 1.0);
@@ -282,81 +310,37 @@ void RenderSystem::drawToScreen()
 	glDisable(GL_DEPTH_TEST);
 
 	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-																	 // indices to the bound GL_ARRAY_BUFFER
-	//gl_has_errors;
+	GLsizei num_indices = bindGeometry(GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE);
 
 	// add the "vignette" effect
-	const GLuint vignette_program = effects[(GLuint)EFFECT_ASSET_ID::VIGNETTE];
-
 	// set clock
-	GLuint time_uloc       = glGetUniformLocation(vignette_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(vignette_program, "darken_screen_factor");
-	GLuint vignette_loc = glGetUniformLocation(vignette_program, "vignette_intensity");
-
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
+	glUniform1f(vignette.time, (float)(glfwGetTime() * 10.0f));
 	
-	ScreenState &screen = registry.screenStates.get(screen_state_entity);
-	// std::cout << "screen.darken_screen_factor: " << screen.darken_screen_factor << " entity id: " << screen_state_entity << std::endl;
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-
-	if (screen.apply_vignette) {
-		screen.vignette_intensity -= 0.02f;
-		if (screen.vignette_intensity <= 0.0f) {
-			screen.vignette_intensity = 0.0f;
-			screen.apply_vignette = 0;
-		}
-	} else {
-		screen.vignette_intensity = 0;
-	}
-	glUniform1f(vignette_loc, screen.vignette_intensity);
-	//gl_has_errors;
-
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(vignette_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
+	// the world fades both, see WorldSystem::step
+	glUniform1f(vignette.darken_screen_factor, snapshot.darken_screen_factor);
+	glUniform1f(vignette.vignette_intensity, snapshot.vignette_intensity);
 	//gl_has_errors;
 
 	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	gl_state.bind_texture(GL_TEXTURE_2D, off_screen_render_buffer_color);
 	//gl_has_errors;
 
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-				  // no offset from the bound index buffer
+	// Draw, one triangle = 3 vertices
+	gl_state.draw_elements(GL_TRIANGLES, num_indices);
 	//gl_has_errors;
 }
 
 // Render our game world
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-void RenderSystem::draw(float elapsed_ms)
+void RenderSystem::draw(const RenderSnapshot& snapshot)
 {
 	// Getting size of window
 	int w, h;
 	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
 
-	// First render to the custom framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
-	//gl_has_errors;
-	
-	// clear backbuffer
+	// the static layer and the frame buffer have the same size
 	glViewport(0, 0, w, h);
 	glDepthRange(0.00001, 10);
-	
-	// white background
-	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-
-	glClearDepth(10.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
@@ -366,37 +350,64 @@ void RenderSystem::draw(float elapsed_ms)
 
 	mat3 projection_2D = createProjectionMatrix();
 
-	// draw all entities with a render request to the frame buffer
-	for (Entity entity : registry.renderRequests.entities)
-	{
-		// filter to entities that have a motion component
-		if (registry.motions.has(entity)) {
-			// Note, its not very efficient to access elements indirectly via the entity
-			// albeit iterating through all Sprites in sequence. A good point to optimize
-			drawTexturedMesh(entity, projection_2D, elapsed_ms);
-		}
-		// draw grid lines separately, as they do not have motion but need to be rendered
-		else if (registry.gridLines.has(entity)) {
-			drawGridLine(entity, projection_2D);
-		}
-	}
+	// all entities with a render request, sorted by layer and GL state, the static layers come first
+	queueRenderPackets(snapshot.items);
+	const std::vector<RenderPacket>& packets = render_queue.get_packets();
+	size_t static_count = 0;
+	while (static_count < packets.size() && render_layer_of(packets[static_count].key) <= last_static_layer)
+		static_count++;
+	updateStaticLayer(snapshot.items, packets.data(), static_count, projection_2D);
+
+	// First render to the custom framebuffer, starting from the static layer instead of a clear
+	gl_state.bind_framebuffer(frame_buffer);
+	glClearDepth(10.f);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	drawStaticLayer();
+	//gl_has_errors;
+
+	drawPackets(snapshot.items, packets.data() + static_count, packets.size() - static_count, projection_2D);
 
 	gl_has_errors();
 
 
 	// call draw particles
-	for (Entity entity : registry.explosions.entities) {
-		const Explosion& explosion = registry.explosions.get(entity);
-		drawParticles(explosion, projection_2D);
-	}
+	if (particle_pool.simulate_on_gpu)
+		drawGpuParticles(snapshot, projection_2D);
+	else
+		drawParticles(snapshot.particles, projection_2D);
 
 	// draw framebuffer to screen
 	// adding "vignette" effect when applied
-	drawToScreen();
+	drawToScreen(snapshot);
 
 	// flicker-free display with a double buffer
 	glfwSwapBuffers(window);
 	//gl_has_errors;
+
+	frame_stats = gl_state.end_frame();
+	total_stats.draw_calls += frame_stats.draw_calls;
+	total_stats.state_changes += frame_stats.state_changes;
+	total_stats.redundant += frame_stats.redundant;
+	frame_count++;
+}
+
+void RenderSystem::start_thread()
+{
+	// the context can only be current on one thread at a time
+	glfwMakeContextCurrent(nullptr);
+	render_thread = std::thread([this]() {
+		glfwMakeContextCurrent(window);
+		while (const RenderSnapshot* snapshot = mailbox.take())
+			draw(*snapshot);
+		glfwMakeContextCurrent(nullptr);
+	});
+}
+
+void RenderSystem::stop_thread()
+{
+	mailbox.close();
+	render_thread.join();
+	glfwMakeContextCurrent(window);
 }
 
 mat3 RenderSystem::createProjectionMatrix()
@@ -1,12 +1,35 @@
 #pragma once
 
 #include <array>
+#include <deque>
+#include <thread>
 #include <utility>
 
 #include "common.hpp"
+#include "gl_state.hpp"
+#include "particle_system.hpp"
+#include "render_queue.hpp"
+#include "render_snapshot.hpp"
+#include "vertex_layout.hpp"
 #include "tinyECS/components.hpp"
 #include "tinyECS/tiny_ecs.hpp"
 
+// A linked shader program and the locations of its uniforms, resolved once when loading it.
+// A location is -1 if the program does not use the uniform. The attribute locations are fixed, see ATTRIBUTE_ID.
+struct Effect {
+	GLuint program = 0;
+	GLint transform = -1;
+	GLint projection = -1;
+	GLint fcolor = -1;
+	GLint color = -1;
+	GLint point_size = -1;
+	GLint time = -1;
+	GLint darken_screen_factor = -1;
+	GLint vignette_intensity = -1;
+	GLint layer = -1;
+	GLint elapsed = -1;
+};
+
 // System responsible for setting up OpenGL and for rendering all the
 // visual entities in the game
 class RenderSystem {
@@ -17,8 +40,12 @@ class RenderSystem {
 	 * Whenever possible, add to these lists instead of creating dynamic state
 	 * it is easier to debug and faster to execute for the computer.
 	 */
-	std::array<GLuint, texture_count> texture_gl_handles;
-	std::array<ivec2, texture_count>  texture_dimensions;
+	// All textures are layers of one texture array, sized to fit the largest. A smaller texture covers
+	// the lower left part of its layer, texture_layers holds that part (xy) and the layer (z).
+	GLuint texture_array;
+	ivec2 texture_array_dimensions;
+	std::array<ivec2, texture_count> texture_dimensions;
+	std::array<vec3, texture_count> texture_layers;
 
 	// Make sure these paths remain in sync with the associated enumerators.
 	// Associated id with .obj path
@@ -40,7 +67,7 @@ class RenderSystem {
 		textures_path("projectiles/gold_bubble.png"),
 	};
 
-	std::array<GLuint, effect_count> effects;
+	std::array<Effect, effect_count> effects;
 	// Make sure these paths remain in sync with the associated enumerators.
 	const std::array<std::string, effect_count> effect_paths = {
 		shader_path("coloured"),
@@ -48,13 +75,50 @@ class RenderSystem {
 		shader_path("chicken"),
 		shader_path("textured"),
 		shader_path("vignette"),
-		shader_path("particle")
+		shader_path("particle"),
+		shader_path("textured_instanced"),
+		shader_path("composite"),
+		shader_path("particle_update")
 	};
 
 	std::array<GLuint, geometry_count> vertex_buffers;
 	std::array<GLuint, geometry_count> index_buffers;
+	std::array<GLsizei, geometry_count> index_counts;
+	// the vertex layout of each geometry and its index buffer
+	std::array<GLuint, geometry_count> vertex_arrays;
 	std::array<Mesh, geometry_count> meshes;
 
+	// Textured sprites are drawn instanced, all in one draw call since they share the texture array.
+	// The instances are uploaded to one buffer per frame.
+	GLuint sprite_instance_buffer;
+	GLuint sprite_instance_vertex_array;	// the SPRITE quad, plus the instance attributes
+	std::vector<SpriteInstance> sprite_instances;
+
+	// The live particles of all emitters are streamed to a ring buffer once per frame, a frame's vertices
+	// follow the previous frame's. When they do not fit, the buffer is orphaned and the ring starts over.
+	// The ring holds the particle pool's capacity, so that a frame always fits a fresh buffer.
+	GLuint particle_buffer;
+	GLuint particle_vertex_array;
+	GLsizeiptr particle_buffer_offset = 0;	// in bytes, where the next frame's vertices go
+
+	// Particles simulated on the GPU (particle_pool.simulate_on_gpu) live in two buffers. Each frame, transform
+	// feedback advances the live particles from one buffer to the start of the other, then the new bursts are
+	// appended. The particles of a burst die together and bursts die in spawn order, so the dead particles
+	// are a prefix of the buffer and the live ones are advanced by one draw call.
+	struct GpuBurst {
+		unsigned int count;
+		float life;		// seconds left
+	};
+	std::array<GLuint, 2> gpu_particle_buffers = { 0, 0 };
+	std::array<GLuint, 2> gpu_particle_vertex_arrays = { 0, 0 };
+	unsigned int gpu_particle_source = 0;	// the buffer holding the particles
+	unsigned int gpu_particle_count = 0;
+	double gpu_particle_time_ms = 0.0;		// the simulated time the particles are at
+	unsigned int gpu_particle_generation = 0;
+	std::deque<GpuBurst> gpu_bursts;		// oldest first
+	std::vector<ParticleBurst> gpu_spawns;
+	std::vector<GpuParticle> gpu_spawn_upload;
+
 public:
 	// Initialize the window
 	bool init(GLFWwindow* window);
@@ -76,27 +140,73 @@ public:
 	// The draw loop first renders to this texture, then it is used for the vignette shader
 	bool initScreenTexture();
 
+	// Initialize the texture caching the static layers (see last_static_layer) and its frame buffer
+	bool initStaticLayer();
+
 	// Destroy resources associated to one or all entities created by the system
 	~RenderSystem();
 
-	// Draw all entities
-	void draw(float elapsed_ms);
+	// Draw all entities of a snapshot
+	void draw(const RenderSnapshot& snapshot);
 
-	void drawParticles(const Explosion&, const mat3&);
+	// Draw on a thread of its own, which owns the GL context until stop_thread(): each frame, it draws the
+	// latest snapshot published to the mailbox. The simulation publishes without waiting for the frame.
+	void start_thread();
+	void stop_thread();
+	RenderMailbox& get_mailbox() { return mailbox; }
+
+	// draws the particles of all explosions, in one draw call
+	void drawParticles(const std::vector<ParticleVertex>& particles, const mat3& projection);
+	// advances and draws the particles simulated on the GPU, in one draw call each
+	void drawGpuParticles(const RenderSnapshot& snapshot, const mat3& projection);
 
 	mat3 createProjectionMatrix();
 
 	Entity get_screen_state_entity() { return screen_state_entity; }
 
+	// counters of the last frame, and summed over all frames
+	const RenderStats& get_frame_stats() const { return frame_stats; }
+	const RenderStats& get_total_stats() const { return total_stats; }
+	unsigned int get_frame_count() const { return frame_count; }
+
 private:
-	// Internal drawing functions for each entity type
-	void drawGridLine(Entity entity, const mat3& projection);
-	void drawTexturedMesh(Entity entity, const mat3& projection, float elapsed_ms);
-	void drawToScreen();
+	// Internal drawing functions, packets index the snapshot's items
+	void drawMesh(const RenderItem& item, const mat3& projection);
+	// fills the render queue with the items to draw this frame
+	void queueRenderPackets(const std::vector<RenderItem>& items);
+	// draws the packets in order, each run that needs the same GL state as one batch
+	void drawPackets(const std::vector<RenderItem>& items, const RenderPacket* packets, size_t count, const mat3& projection);
+	// draws packets that need the same GL state
+	void drawBatch(const std::vector<RenderItem>& items, const RenderPacket* packets, size_t count, const mat3& projection);
+	// re-renders the static layer if its packets changed since it was rendered last
+	void updateStaticLayer(const std::vector<RenderItem>& items, const RenderPacket* packets, size_t count, const mat3& projection);
+	// copies the static layer to the bound frame buffer, replacing its content
+	void drawStaticLayer();
+	// collects the instance of a textured sprite, drawn by drawSprites
+	void addSprite(const RenderItem& item);
+	void drawSprites(const mat3& projection);
+	void drawToScreen(const RenderSnapshot& snapshot);
+
+	// binds the vertex array of the geometry, returns its number of indices
+	GLsizei bindGeometry(GEOMETRY_BUFFER_ID geometry);
 
 	// Window handle
 	GLFWwindow* window;
 
+	RenderMailbox mailbox;
+	std::thread render_thread;
+
+	RenderQueue render_queue;
+	GlState gl_state;
+	RenderStats frame_stats;
+	RenderStats total_stats;
+	unsigned int frame_count = 0;
+
+	// The static layers and the background, rendered only when static_layer_signature changes
+	GLuint static_layer_frame_buffer;
+	GLuint static_layer_texture;
+	uint64_t static_layer_signature = 0;	// 0: not rendered yet
+
 	// Screen texture handles
 	GLuint frame_buffer;
 	GLuint off_screen_render_buffer_color;
@@ -105,5 +215,7 @@ private:
 	Entity screen_state_entity;
 };
 
+// 'feedback_varyings' are the vertex shader outputs captured by transform feedback, interleaved in one buffer
 bool loadEffectFromFile(
-	const std::string& vs_path, const std::string& fs_path, GLuint& out_program);
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program,
+	const std::vector<const char*>& feedback_varyings = {});
@@ -2,12 +2,14 @@
 #include <iostream>
 #include <sstream>
 #include <array>
+#include <cstring>
 #include <fstream>
 
 // internal
 #include "../ext/stb_image/stb_image.h"
 #include "render_system.hpp"
 #include "tinyECS/registry.hpp"
+#include "particle_system.hpp"
 
 
 // Render initialization
@@ -45,45 +47,83 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 	// code to use OpenGL 4.3 (not suported on mac) and add additional .h and .cpp
 	// glDebugMessageCallback((GLDEBUGPROC)errorCallback, nullptr);
 
-	// We are not really using VAO's but without at least one bound we will crash in
-	// some systems.
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-	//gl_has_errors()();
+	// particles set their size in particle.vs.glsl
+	glEnable(GL_PROGRAM_POINT_SIZE);
 
 	initScreenTexture();
+	initStaticLayer();
     initializeGlTextures();
 	initializeGlEffects();
 	initializeGlGeometryBuffers();
 
+	// loading bound all kinds of objects
+	gl_state.invalidate();
+
 	return true;
 }
 
-void RenderSystem::initializeGlTextures()
+// Copies an image into the lower left corner of a transparent texture array layer. If the image is
+// smaller than the layer, it is surrounded by its opposite edge texels, so that linear filtering at its
+// edges repeats it, as it would as a texture of its own.
+static std::vector<stbi_uc> imageToLayer(const stbi_uc* image, ivec2 image_size, ivec2 layer_size)
 {
-    glGenTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	std::vector<stbi_uc> layer(4 * layer_size.x * layer_size.y, 0);
+	auto source_of = [](int texel, int image_extent, int layer_extent) {
+		if (texel < image_extent)
+			return texel;
+		if (texel == image_extent)
+			return 0;					// right after the image, its first column (row)
+		if (texel == layer_extent - 1)
+			return image_extent - 1;	// wraps to before the image, its last column (row)
+		return -1;
+	};
+	for (int y = 0; y < layer_size.y; y++) {
+		int source_y = source_of(y, image_size.y, layer_size.y);
+		for (int x = 0; source_y >= 0 && x < layer_size.x; x++) {
+			int source_x = source_of(x, image_size.x, layer_size.x);
+			if (source_x >= 0)
+				memcpy(&layer[4 * (y * layer_size.x + x)], &image[4 * (source_y * image_size.x + source_x)], 4);
+		}
+	}
+	return layer;
+}
 
+void RenderSystem::initializeGlTextures()
+{
+	// the layers fit the largest texture
+	std::array<stbi_uc*, texture_count> images;
+	texture_array_dimensions = { 0, 0 };
     for(uint i = 0; i < texture_paths.size(); i++)
     {
 		const std::string& path = texture_paths[i];
 		ivec2& dimensions = texture_dimensions[i];
 
-		stbi_uc* data;
-		data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
+		images[i] = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
 
-		if (data == NULL)
+		if (images[i] == NULL)
 		{
 			const std::string message = "Could not load the file " + path + ".";
 			fprintf(stderr, "%s", message.c_str());
 			assert(false);
 		}
-		glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		//gl_has_errors()();
-		stbi_image_free(data);
+		texture_array_dimensions = max(texture_array_dimensions, dimensions);
+    }
+
+	glGenTextures(1, &texture_array);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, texture_array_dimensions.x, texture_array_dimensions.y, texture_count,
+		0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    for(uint i = 0; i < texture_paths.size(); i++)
+    {
+		const ivec2& dimensions = texture_dimensions[i];
+		std::vector<stbi_uc> layer = imageToLayer(images[i], dimensions, texture_array_dimensions);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, texture_array_dimensions.x, texture_array_dimensions.y, 1,
+			GL_RGBA, GL_UNSIGNED_BYTE, layer.data());
+		texture_layers[i] = vec3(vec2(dimensions) / vec2(texture_array_dimensions), (float)i);
+		stbi_image_free(images[i]);
     }
 	//gl_has_errors()();
 }
@@ -95,8 +135,26 @@ void RenderSystem::initializeGlEffects()
 		const std::string vertex_shader_name = effect_paths[i] + ".vs.glsl";
 		const std::string fragment_shader_name = effect_paths[i] + ".fs.glsl";
 
-		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i]);
-		assert(is_valid && (GLuint)effects[i] != 0);
+		Effect& effect = effects[i];
+		// the particle update is captured into the other particle buffer, see drawGpuParticles
+		std::vector<const char*> feedback_varyings;
+		if (i == (uint)EFFECT_ASSET_ID::PARTICLE_UPDATE)
+			feedback_varyings = { "out_position", "out_color", "out_velocity" };
+
+		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effect.program, feedback_varyings);
+		assert(is_valid && effect.program != 0);
+
+		// the draw functions only use these, no name lookups while drawing
+		effect.transform = glGetUniformLocation(effect.program, "transform");
+		effect.projection = glGetUniformLocation(effect.program, "projection");
+		effect.fcolor = glGetUniformLocation(effect.program, "fcolor");
+		effect.color = glGetUniformLocation(effect.program, "color");
+		effect.point_size = glGetUniformLocation(effect.program, "point_size");
+		effect.time = glGetUniformLocation(effect.program, "time");
+		effect.darken_screen_factor = glGetUniformLocation(effect.program, "darken_screen_factor");
+		effect.vignette_intensity = glGetUniformLocation(effect.program, "vignette_intensity");
+		effect.layer = glGetUniformLocation(effect.program, "layer");
+		effect.elapsed = glGetUniformLocation(effect.program, "elapsed");
 	}
 }
 
@@ -104,6 +162,9 @@ void RenderSystem::initializeGlEffects()
 template <class T>
 void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices)
 {
+	// the vertex array records the attribute layout and the index buffer
+	glBindVertexArray(vertex_arrays[(uint)gid]);
+
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)gid]);
 	glBufferData(GL_ARRAY_BUFFER,
 		sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
@@ -112,7 +173,10 @@ void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)gid]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 		sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	index_counts[(uint)gid] = (GLsizei)indices.size();
 	//gl_has_errors()();
+
+	setVertexLayout<T>();
 }
 
 void RenderSystem::initializeGlMeshes()
@@ -139,6 +203,12 @@ void RenderSystem::initializeGlGeometryBuffers()
 	glGenBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	// Index Buffer creation.
 	glGenBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	// Vertex array creation.
+	glGenVertexArrays((GLsizei)vertex_arrays.size(), vertex_arrays.data());
+	// Instance buffer, filled every frame
+	glGenBuffers(1, &sprite_instance_buffer);
+	// Particle ring buffer, streamed to every frame
+	glGenBuffers(1, &particle_buffer);
 
 	// Index and Vertex buffer data initialization.
 	initializeGlMeshes();
@@ -222,6 +292,37 @@ void RenderSystem::initializeGlGeometryBuffers()
 	// Counterclockwise as it's the default opengl front winding direction.
 	const std::vector<uint16_t> screen_indices = { 0, 1, 2 };
 	bindVBOandIBO(GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE, screen_vertices, screen_indices);
+
+	///////////////////////////////////////////////////////
+	// Initialize instanced sprites: the sprite quad, and per instance the attributes in the instance buffer
+	glGenVertexArrays(1, &sprite_instance_vertex_array);
+	glBindVertexArray(sprite_instance_vertex_array);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)GEOMETRY_BUFFER_ID::SPRITE]);
+	setVertexLayout<TexturedVertex>();
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)GEOMETRY_BUFFER_ID::SPRITE]);
+	glBindBuffer(GL_ARRAY_BUFFER, sprite_instance_buffer);
+	setVertexLayout<SpriteInstance>(0, 1);
+
+	///////////////////////////////////////////////////////
+	// Initialize particles: one point per vertex of the ring buffer, see drawParticles
+	glGenVertexArrays(1, &particle_vertex_array);
+	glBindVertexArray(particle_vertex_array);
+	glBindBuffer(GL_ARRAY_BUFFER, particle_buffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(ParticleVertex) * particle_pool.capacity(), nullptr, GL_STREAM_DRAW);
+	setVertexLayout<ParticleVertex>();
+
+	///////////////////////////////////////////////////////
+	// Initialize GPU particles, only when they are simulated there: both buffers hold the pool's capacity
+	if (particle_pool.simulate_on_gpu) {
+		glGenBuffers((GLsizei)gpu_particle_buffers.size(), gpu_particle_buffers.data());
+		glGenVertexArrays((GLsizei)gpu_particle_vertex_arrays.size(), gpu_particle_vertex_arrays.data());
+		for (uint i = 0; i < gpu_particle_buffers.size(); i++) {
+			glBindVertexArray(gpu_particle_vertex_arrays[i]);
+			glBindBuffer(GL_ARRAY_BUFFER, gpu_particle_buffers[i]);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(GpuParticle) * particle_pool.capacity(), nullptr, GL_DYNAMIC_COPY);
+			setVertexLayout<GpuParticle>();
+		}
+	}
 }
 
 RenderSystem::~RenderSystem()
@@ -230,16 +331,25 @@ RenderSystem::~RenderSystem()
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
-	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	glDeleteBuffers(1, &sprite_instance_buffer);
+	glDeleteBuffers(1, &particle_buffer);
+	glDeleteBuffers((GLsizei)gpu_particle_buffers.size(), gpu_particle_buffers.data());
+	glDeleteVertexArrays((GLsizei)vertex_arrays.size(), vertex_arrays.data());
+	glDeleteVertexArrays(1, &sprite_instance_vertex_array);
+	glDeleteVertexArrays(1, &particle_vertex_array);
+	glDeleteVertexArrays((GLsizei)gpu_particle_vertex_arrays.size(), gpu_particle_vertex_arrays.data());
+	glDeleteTextures(1, &texture_array);
 	glDeleteTextures(1, &off_screen_render_buffer_color);
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
+	glDeleteTextures(1, &static_layer_texture);
 	//gl_has_errors()();
 
 	for(uint i = 0; i < effect_count; i++) {
-		glDeleteProgram(effects[i]);
+		glDeleteProgram(effects[i].program);
 	}
 	// delete allocated resources
 	glDeleteFramebuffers(1, &frame_buffer);
+	glDeleteFramebuffers(1, &static_layer_frame_buffer);
 	//gl_has_errors()();
 
 	// remove all entities created by the render system
@@ -275,6 +385,29 @@ bool RenderSystem::initScreenTexture()
 	return true;
 }
 
+bool RenderSystem::initStaticLayer()
+{
+	int framebuffer_width, framebuffer_height;
+	glfwGetFramebufferSize(const_cast<GLFWwindow*>(window), &framebuffer_width, &framebuffer_height);
+
+	// copied texel by texel to the screen texture of the same size
+	glGenTextures(1, &static_layer_texture);
+	glBindTexture(GL_TEXTURE_2D, static_layer_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+	glGenFramebuffers(1, &static_layer_frame_buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, static_layer_frame_buffer);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, static_layer_texture, 0);
+	//gl_has_errors();
+
+	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	return true;
+}
+
 bool gl_compile_shader(GLuint shader)
 {
 	glCompileShader(shader);
@@ -299,7 +432,8 @@ bool gl_compile_shader(GLuint shader)
 }
 
 bool loadEffectFromFile(
-	const std::string& vs_path, const std::string& fs_path, GLuint& out_program)
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program,
+	const std::vector<const char*>& feedback_varyings)
 {
 	// Opening files
 	std::ifstream vs_is(vs_path);
@@ -346,6 +480,12 @@ bool loadEffectFromFile(
 	out_program = glCreateProgram();
 	glAttachShader(out_program, vertex);
 	glAttachShader(out_program, fragment);
+	// same attribute locations in all effects, see ATTRIBUTE_ID; names a shader does not use are ignored
+	for (uint i = 0; i < attribute_names.size(); i++)
+		if (attribute_names[i])
+			glBindAttribLocation(out_program, i, attribute_names[i]);
+	if (!feedback_varyings.empty())
+		glTransformFeedbackVaryings(out_program, (GLsizei)feedback_varyings.size(), feedback_varyings.data(), GL_INTERLEAVED_ATTRIBS);
 	glLinkProgram(out_program);
 	//gl_has_errors()();
 
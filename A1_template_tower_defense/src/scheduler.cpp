@@ -0,0 +1,110 @@
+// internal
+#include "scheduler.hpp"
+#include "job_system.hpp"
+
+// stlib
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+	bool overlaps(const std::vector<const void*>& a, const std::vector<const void*>& b)
+	{
+		for (const void* resource : a)
+			if (std::find(b.begin(), b.end(), resource) != b.end())
+				return true;
+		return false;
+	}
+}
+
+bool SystemAccess::conflicts(const SystemAccess& other) const
+{
+	return overlaps(writes, other.writes) || overlaps(writes, other.reads) || overlaps(reads, other.writes)
+		|| (main_thread && other.main_thread);
+}
+
+Scheduler::SystemId Scheduler::add(const std::string& name, const SystemAccess& access, std::function<void(float)> function,
+	const std::vector<SystemId>& after)
+{
+	const SystemId id = (SystemId)systems.size();
+
+	System system;
+	system.access = access;
+	system.function = std::move(function);
+	system.after = after;
+	system.ancestors.assign(systems.size(), false);
+	for (SystemId dependency : after) {
+		assert(dependency >= 0 && dependency < id && "Systems can only run after systems registered before them");
+		system.ancestors[dependency] = true;
+		for (SystemId i = 0; i < dependency; i++)
+			if (systems[dependency].ancestors[i])
+				system.ancestors[i] = true;
+	}
+
+	// every conflicting system must be ordered before this one
+	for (SystemId i = 0; i < id; i++) {
+		if (system.ancestors[i] || !access.conflicts(systems[i].access))
+			continue;
+		fprintf(stderr, "Scheduler: %s and %s access the same data without an order, running them in registration order\n",
+			timings[i].name.c_str(), name.c_str());
+		races++;
+		system.after.push_back(i);
+		system.ancestors[i] = true;
+		for (SystemId j = 0; j < i; j++)
+			if (systems[i].ancestors[j])
+				system.ancestors[j] = true;
+	}
+
+	systems.push_back(std::move(system));
+	SystemTiming timing;
+	timing.name = name;
+	timings.push_back(timing);
+	return id;
+}
+
+void Scheduler::run_system(SystemId id, float elapsed_ms)
+{
+	SystemTiming& timing = timings[id];
+	auto t = Clock::now();
+	systems[id].function(elapsed_ms);
+	timing.last_us = (float)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t).count();
+	timing.total_us += timing.last_us;
+	timing.runs++;
+}
+
+void Scheduler::run(float elapsed_ms)
+{
+	// without workers there is nothing to overlap, registration order respects all dependencies
+	if (job_system.get_thread_count() == 1) {
+		for (SystemId id = 0; id < (SystemId)systems.size(); id++)
+			run_system(id, elapsed_ms);
+		return;
+	}
+
+	std::vector<JobHandle> jobs(systems.size());
+	for (SystemId id = 0; id < (SystemId)systems.size(); id++) {
+		System& system = systems[id];
+		auto timed = [this, id, elapsed_ms]() { run_system(id, elapsed_ms); };
+
+		std::vector<JobHandle> dependencies;
+		for (SystemId dependency : system.after)
+			dependencies.push_back(jobs[dependency]);
+
+		if (!system.access.main_thread) {
+			jobs[id] = job_system.create(timed, dependencies);
+			continue;
+		}
+
+		// helps with the other jobs until the dependencies are done
+		for (const JobHandle& dependency : dependencies)
+			job_system.wait(dependency);
+		timed();
+		jobs[id] = std::make_shared<Job>();
+		jobs[id]->done = true;
+	}
+
+	for (const JobHandle& job : jobs)
+		job_system.wait(job);
+}
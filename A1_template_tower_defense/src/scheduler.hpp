@@ -0,0 +1,89 @@
+#pragma once
+
+// stlib
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tinyECS/registry.hpp"
+
+// The shared state a system touches: component containers, and any other object (e.g., the influence map).
+// Accessing a container reads the registry's layout, creating or destroying entities writes it.
+class SystemAccess
+{
+public:
+	template <typename Component>
+	SystemAccess& read(const ComponentContainer<Component>& container)
+	{
+		reads.push_back(&container);
+		reads.push_back(&registry);
+		return *this;
+	}
+
+	template <typename Component>
+	SystemAccess& write(const ComponentContainer<Component>& container)
+	{
+		writes.push_back(&container);
+		reads.push_back(&registry);
+		return *this;
+	}
+
+	SystemAccess& read_resource(const void* resource) { reads.push_back(resource); return *this; }
+	SystemAccess& write_resource(const void* resource) { writes.push_back(resource); return *this; }
+
+	// inserts or removes components of any container, i.e., creates or destroys entities
+	SystemAccess& spawns() { writes.push_back(&registry); return *this; }
+
+	// e.g., GLFW or audio calls
+	SystemAccess& on_main_thread() { main_thread = true; return *this; }
+
+	// whether the two systems can't run at the same time
+	bool conflicts(const SystemAccess& other) const;
+
+	std::vector<const void*> reads;
+	std::vector<const void*> writes;
+	bool main_thread = false;
+};
+
+// Time spent in a system
+struct SystemTiming {
+	std::string name;
+	float last_us = 0.f;
+	float total_us = 0.f;
+	unsigned int runs = 0;
+};
+
+// Runs the registered systems once per step, each as a job (see job_system.hpp) that starts when the
+// systems it was declared to run after finished. Systems without an order between them run concurrently.
+// Registration checks the declared accesses: two systems that conflict must be ordered (directly or through
+// other systems), otherwise the pair is reported as a data race and ordered by registration.
+class Scheduler
+{
+public:
+	using SystemId = int;
+
+	// 'after' are systems registered earlier, returns the id of the new system
+	SystemId add(const std::string& name, const SystemAccess& access, std::function<void(float)> function,
+		const std::vector<SystemId>& after = {});
+
+	// runs all systems and waits for them, main thread systems are run by the calling thread
+	void run(float elapsed_ms);
+
+	// number of races found while registering
+	unsigned int get_race_count() const { return races; }
+	const std::vector<SystemTiming>& get_timings() const { return timings; }
+
+private:
+	void run_system(SystemId id, float elapsed_ms);
+
+	struct System {
+		SystemAccess access;
+		std::function<void(float)> function;
+		std::vector<SystemId> after;
+		std::vector<bool> ancestors;	// per system, whether this one runs after it
+	};
+
+	std::vector<System> systems;
+	std::vector<SystemTiming> timings;
+	unsigned int races = 0;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+// Minimal 4-wide float vector for the grid and particle kernels.
+// Maps to SSE on x86, NEON on ARM (e.g., M-series Macs) and falls back to plain scalar code otherwise.
+// Loads and stores are unaligned, callers only need to pad their arrays to a multiple of 4.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+namespace simd {
+
+#if defined(SIMD_SSE)
+
+struct float4 { __m128 v; };
+
+inline float4 load(const float* p) { return { _mm_loadu_ps(p) }; }
+inline void store(float* p, float4 a) { _mm_storeu_ps(p, a.v); }
+inline float4 splat(float x) { return { _mm_set1_ps(x) }; }
+inline float4 operator+(float4 a, float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline float4 operator-(float4 a, float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline float4 operator*(float4 a, float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline float4 min(float4 a, float4 b) { return { _mm_min_ps(a.v, b.v) }; }
+inline float4 max(float4 a, float4 b) { return { _mm_max_ps(a.v, b.v) }; }
+
+#elif defined(SIMD_NEON)
+
+struct float4 { float32x4_t v; };
+
+inline float4 load(const float* p) { return { vld1q_f32(p) }; }
+inline void store(float* p, float4 a) { vst1q_f32(p, a.v); }
+inline float4 splat(float x) { return { vdupq_n_f32(x) }; }
+inline float4 operator+(float4 a, float4 b) { return { vaddq_f32(a.v, b.v) }; }
+inline float4 operator-(float4 a, float4 b) { return { vsubq_f32(a.v, b.v) }; }
+inline float4 operator*(float4 a, float4 b) { return { vmulq_f32(a.v, b.v) }; }
+inline float4 min(float4 a, float4 b) { return { vminq_f32(a.v, b.v) }; }
+inline float4 max(float4 a, float4 b) { return { vmaxq_f32(a.v, b.v) }; }
+
+#else
+
+struct float4 { float v[4]; };
+
+inline float4 load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+inline void store(float* p, float4 a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+inline float4 splat(float x) { return { { x, x, x, x } }; }
+inline float4 operator+(float4 a, float4 b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+inline float4 operator-(float4 a, float4 b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+inline float4 operator*(float4 a, float4 b) { for (int i = 0; i < 4; i++) a.v[i] *= b.v[i]; return a; }
+inline float4 min(float4 a, float4 b) { for (int i = 0; i < 4; i++) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+inline float4 max(float4 a, float4 b) { for (int i = 0; i < 4; i++) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+
+#endif
+
+}
@@ -0,0 +1,78 @@
+// stlib
+#include <chrono>
+
+// internal
+#include "systems.hpp"
+#include "influence_map.hpp"
+#include "particle_system.hpp"
+#include "events.hpp"
+
+void schedule_systems(Scheduler& scheduler, WorldSystem& world, AISystem& ai, PhysicsSystem& physics)
+{
+	// spawns waves, removes what left the screen, and sets the window title
+	Scheduler::SystemId world_step = scheduler.add("world",
+		SystemAccess().spawns().write_resource(&world).write_resource(&influence_map).on_main_thread(),
+		[&world](float elapsed_ms) { world.step(elapsed_ms); });
+
+	// these three touch disjoint data and run concurrently
+	Scheduler::SystemId animations = scheduler.add("animations",
+		SystemAccess().read(registry.invaders).write(registry.animations).write(registry.renderRequests),
+		[&world](float elapsed_ms) { world.step_animations(elapsed_ms); },
+		{ world_step });
+
+	Scheduler::SystemId particles = scheduler.add("particles",
+		SystemAccess().read_resource(&world).write(registry.explosions).write_resource(&particle_pool),
+		[&world](float elapsed_ms) { world.step_particles(elapsed_ms); },
+		{ world_step });
+
+	Scheduler::SystemId ai_targeting = scheduler.add("ai",
+		SystemAccess().read(registry.invaders).write(registry.towers).write(registry.aiAgents).write(registry.motions).write_resource(&ai),
+		[&ai](float elapsed_ms) { ai.step(elapsed_ms); },
+		{ world_step });
+
+	Scheduler::SystemId ai_shots = scheduler.add("ai shots",
+		SystemAccess().spawns().write_resource(&ai),
+		[&ai](float) { ai.spawn_shots(); },
+		{ ai_targeting, animations, particles });
+
+	Scheduler::SystemId physics_step = scheduler.add("physics",
+		SystemAccess().write(registry.motions).write(registry.invaders).write_resource(&collision_events).write_resource(&influence_map),
+		[&physics](float elapsed_ms) { physics.step(elapsed_ms); },
+		{ ai_shots });
+
+	// plays sounds
+	Scheduler::SystemId collisions = scheduler.add("collisions",
+		SystemAccess().spawns().write_resource(&world).read_resource(&collision_events).write_resource(&damage_events).on_main_thread(),
+		[&world](float) { world.handle_collisions(); },
+		{ physics_step });
+
+	scheduler.add("damage",
+		SystemAccess().spawns().write_resource(&world).read_resource(&damage_events).on_main_thread(),
+		[&world](float) { world.handle_damage(); },
+		{ collisions });
+}
+
+int run_frame(Scheduler& scheduler, WorldSystem& world, float frame_ms)
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	// fixed ticks, the ones that came due in the frame, a replay dictates the tick lengths
+	FastForward& fast_forward = world.get_fast_forward();
+	bool fast_forwarding = fast_forward.is_on();
+	int ticks = fast_forward.plan(frame_ms);
+	for (int i = 0; i < ticks; i++) {
+		float tick_ms = SIM_TICK_MS;
+		if (world.is_replaying() && !world.next_replay_tick(tick_ms))
+			return -1;
+
+		// CK: be mindful of the order of your systems, see schedule_systems
+		auto tick_start = Clock::now();
+		scheduler.run(tick_ms);
+		fast_forward.add_tick_time((float)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tick_start).count());
+
+		// the remaining ticks were planned for the fast-forward
+		if (fast_forwarding && !fast_forward.is_on())
+			return i + 1;
+	}
+	return ticks;
+}
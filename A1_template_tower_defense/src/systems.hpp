@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ai_system.hpp"
+#include "physics_system.hpp"
+#include "scheduler.hpp"
+#include "world_system.hpp"
+
+// Registers the game's systems with the scheduler, in the order of a step. Shared by the game and the headless build.
+void schedule_systems(Scheduler& scheduler, WorldSystem& world, AISystem& ai, PhysicsSystem& physics);
+
+// Runs the ticks of a frame that took 'frame_ms' of real time, as planned by the world's FastForward.
+// Fast-forward ticks that were planned but come after the wave end or game over stopped it are skipped.
+// Returns the number of ticks that ran, or -1 once a replay ran out of ticks.
+int run_frame(Scheduler& scheduler, WorldSystem& world, float frame_ms);
@@ -1,5 +1,4 @@
 #include "components.hpp"
-#include "render_system.hpp" // for gl_has_errors
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../ext/stb_image/stb_image.h"
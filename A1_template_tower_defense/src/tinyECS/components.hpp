@@ -20,6 +20,7 @@ struct Tower {
 struct Invader {
 	int health;
 	int type; // 0 for blue, 1 for spikey added this to keep track
+	int influence_cell = -1; // cell the invader is accounted in by the influence map
 };
 
 // Projectile
@@ -47,14 +48,6 @@ struct Motion {
 	vec2  scale    = { 10, 10 };
 };
 
-// Stucture to store collision information
-struct Collision
-{
-	// Note, the first object is stored in the ECS container.entities
-	Entity other; // the second object involved in the collision
-	Collision(Entity& other) { this->other = other; };
-};
-
 // Data structure for toggling debug mode
 struct Debug {
 	bool in_debug_mode = 0;
@@ -103,6 +96,29 @@ struct TexturedVertex
 	vec2 texcoord;
 };
 
+// Per-instance element of the sprite instance buffer (textured_instanced.vs.glsl)
+struct SpriteInstance
+{
+	mat3 transform;
+	vec3 color;
+	vec3 layer;		// xy: the part of the texture array layer covered by the texture, z: the layer
+};
+
+// Element of the particle vertex buffer (particle.vs.glsl), one point per live particle
+struct ParticleVertex
+{
+	vec2 position;
+	vec4 color;		// the emitter's color, the alpha fades with the particle's life
+};
+
+// Element of the GPU particle buffers, written by transform feedback in this order (particle_update.vs.glsl)
+struct GpuParticle
+{
+	vec2 position;
+	vec4 color;		// as in ParticleVertex
+	vec2 velocity;
+};
+
 // Mesh datastructure for storing vertex and index buffers
 struct Mesh
 {
@@ -112,26 +128,20 @@ struct Mesh
 	std::vector<uint16_t> vertex_indices;
 };
 
-// Paritcle data structure for explosions and particles
-struct Particle {
-	vec2 position;
-	vec2 velocity;
-	float lifespan;
-	float rotation_speed;
-	vec4 color;
-};
-
+// Particle emitter, its particles live in a range of the global particle pool (see particle_system.hpp)
 struct Explosion {
-	std::vector<Particle> particles;
-	float duration;
-	float timer;
+	bool has_range = false;		// false if the pool was full
+	unsigned int first = 0;		// first particle of the range
+	unsigned int count = 0;		// particles still alive
+	vec4 color = { 1.f, 1.f, 1.f, 1.f };
+	float duration = 1.0f;
+	float timer = 0.0f;
 };
 
 struct Animation {
 	float timer = 0.0f;
 	float frame_duration = 0.3f;
 	bool is_walking = false;
-	float elapsed_time;
 	int current_frame = 0;  
 	int total_frames = 3;             
 };
@@ -180,7 +190,10 @@ enum class EFFECT_ASSET_ID {
 	TEXTURED = CHICKEN + 1,
 	VIGNETTE = TEXTURED + 1,
 	PARTICLE = VIGNETTE + 1,
-	EFFECT_COUNT = PARTICLE + 1
+	TEXTURED_INSTANCED = PARTICLE + 1,
+	COMPOSITE = TEXTURED_INSTANCED + 1,
+	PARTICLE_UPDATE = COMPOSITE + 1,
+	EFFECT_COUNT = PARTICLE_UPDATE + 1
 };
 const int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
 
@@ -194,9 +207,39 @@ enum class GEOMETRY_BUFFER_ID {
 };
 const int geometry_count = (int)GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
 
+// Drawn in this order, from the back to the front
+enum class RENDER_LAYER {
+	GRID = 0,
+	TOWERS = GRID + 1,
+	INVADERS = TOWERS + 1,
+	PROJECTILES = INVADERS + 1,
+	DEBUG = PROJECTILES + 1,
+	LAYER_COUNT = DEBUG + 1
+};
+const int layer_count = (int)RENDER_LAYER::LAYER_COUNT;
+// the layers up to this one only change when towers are placed or removed, the renderer caches them
+const RENDER_LAYER last_static_layer = RENDER_LAYER::TOWERS;
+
+enum class BEHAVIOR_TREE_ID {
+	TOWER = 0,
+	INVADER = TOWER + 1,
+	BEHAVIOR_TREE_COUNT = INVADER + 1
+};
+const int behavior_tree_count = (int)BEHAVIOR_TREE_ID::BEHAVIOR_TREE_COUNT;
+
+// Per-agent state of the time-sliced AI scheduler and the behavior tree it runs, see AISystem
+struct AIAgent {
+	BEHAVIOR_TREE_ID tree = BEHAVIOR_TREE_ID::BEHAVIOR_TREE_COUNT;
+	float pending_ms = 0;	// simulation time not yet consumed by the agent's logic
+	int step_ms = 0;		// whole milliseconds simulated by the current update
+	unsigned int updated_frame = 0;	// AI frame of the last update, an agent is updated at most once per frame
+	bool boost_queued = false;		// near the action, waiting in the AI's queue of boosted agents
+};
+
 struct RenderRequest {
 	TEXTURE_ASSET_ID   used_texture  = TEXTURE_ASSET_ID::TEXTURE_COUNT;
 	EFFECT_ASSET_ID    used_effect   = EFFECT_ASSET_ID::EFFECT_COUNT;
 	GEOMETRY_BUFFER_ID used_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+	RENDER_LAYER       layer         = RENDER_LAYER::LAYER_COUNT;
 };
 
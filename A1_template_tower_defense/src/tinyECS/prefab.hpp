@@ -0,0 +1,65 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+
+#include "tiny_ecs.hpp"
+
+// A prefab describes the full component set of an entity kind once: for every component
+// the container it goes into and the value new entities start with, e.g.
+//
+//   auto prefab = make_prefab(
+//       prefab_part(registry.projectiles, Projectile{ PROJECTILE_DAMAGE }),
+//       prefab_part(registry.motions));
+//
+// All containers of a prefab must be different.
+template <typename Component>
+struct PrefabPart {
+	ComponentContainer<Component>* container;
+	Component value;
+};
+
+template <typename Component>
+PrefabPart<Component> prefab_part(ComponentContainer<Component>& container, Component value = Component())
+{
+	return { &container, std::move(value) };
+}
+
+template <typename... Components>
+struct Prefab {
+	std::tuple<PrefabPart<Components>...> parts;
+};
+
+template <typename... Components>
+Prefab<Components...> make_prefab(PrefabPart<Components>... parts)
+{
+	return { std::make_tuple(std::move(parts)...) };
+}
+
+// Creates a single entity from a prefab.
+// init_fn(entity, components...) customizes the entity. It receives references to the
+// entity's new components in the order of the prefab, so no lookups are needed.
+template <typename InitFn, typename... Components>
+Entity spawn(const Prefab<Components...>& prefab, InitFn init_fn)
+{
+	Entity entity = Entity();
+	std::apply([&](const PrefabPart<Components>&... parts) {
+		// a new entity can not have any components yet, skip the duplicate check
+		init_fn(entity, parts.container->insert(entity, parts.value, false)...);
+	}, prefab.parts);
+	return entity;
+}
+
+// Creates 'count' entities from a prefab. All containers of the prefab grow once up front,
+// then the entities are created in a single pass. init_fn(i, entity, components...) customizes
+// the i-th entity, as for spawn().
+template <typename InitFn, typename... Components>
+void spawn_batch(const Prefab<Components...>& prefab, size_t count, InitFn init_fn)
+{
+	if (count == 0)
+		return;
+	std::apply([count](const PrefabPart<Components>&... parts) { (parts.container->reserve(count), ...); }, prefab.parts);
+
+	for (size_t i = 0; i < count; i++)
+		spawn(prefab, [&](Entity entity, Components&... components) { init_fn(i, entity, components...); });
+}
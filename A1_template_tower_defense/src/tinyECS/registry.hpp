@@ -1,9 +1,18 @@
 #pragma once
+#include <memory>
 #include <vector>
 
 #include "tiny_ecs.hpp"
 #include "components.hpp"
 
+// Saved contents of all containers of the registry, in registry_list order
+struct RegistrySnapshot
+{
+	std::vector<std::unique_ptr<ContainerSnapshot>> containers;
+
+	bool empty() const { return containers.empty(); }
+};
+
 class ECSRegistry
 {
 	// callbacks to remove a particular or all entities in the system
@@ -14,7 +23,6 @@ public:
 	// TODO: A1 add a LightUp component
 	ComponentContainer<DeathTimer> deathTimers;
 	ComponentContainer<Motion> motions;
-	ComponentContainer<Collision> collisions;
 	ComponentContainer<Player> players;
 	ComponentContainer<Mesh*> meshPtrs;
 	ComponentContainer<RenderRequest> renderRequests;
@@ -30,6 +38,7 @@ public:
 	ComponentContainer<Projectile> projectiles;
 	ComponentContainer<Explosion> explosions;
 	ComponentContainer<Animation> animations;
+	ComponentContainer<AIAgent> aiAgents;
 
 	// constructor that adds all containers for looping over them
 	ECSRegistry()
@@ -37,7 +46,6 @@ public:
 		// TODO: A1 add a LightUp component
 		registry_list.push_back(&deathTimers);
 		registry_list.push_back(&motions);
-		registry_list.push_back(&collisions);
 		registry_list.push_back(&players);
 		registry_list.push_back(&meshPtrs);
 		registry_list.push_back(&renderRequests);
@@ -50,6 +58,9 @@ public:
 		registry_list.push_back(&gridLines);
 		registry_list.push_back(&invaders);
 		registry_list.push_back(&projectiles);
+		registry_list.push_back(&explosions);
+		registry_list.push_back(&animations);
+		registry_list.push_back(&aiAgents);
 	}
 
 	void clear_all_components() {
@@ -57,6 +68,21 @@ public:
 			reg->clear();
 	}
 
+	// Capture all components, e.g., of the freshly initialized world
+	RegistrySnapshot snapshot() {
+		RegistrySnapshot snapshot;
+		for (ContainerInterface* reg : registry_list)
+			snapshot.containers.push_back(reg->snapshot());
+		return snapshot;
+	}
+
+	// Replace all components by a snapshot, entities created since then are gone without being removed one by one
+	void restore(const RegistrySnapshot& snapshot) {
+		assert(snapshot.containers.size() == registry_list.size() && "Snapshot of a different registry");
+		for (size_t i = 0; i < registry_list.size(); i++)
+			registry_list[i]->restore(*snapshot.containers[i]);
+	}
+
 	void list_all_components() {
 		printf("Debug info on all registry entries:\n");
 		for (ContainerInterface* reg : registry_list)
@@ -71,6 +97,13 @@ public:
 				printf("type %s\n", typeid(*reg).name());
 	}
 
+	bool has_any_component(Entity e) {
+		for (ContainerInterface* reg : registry_list)
+			if (reg->has(e))
+				return true;
+		return false;
+	}
+
 	void remove_all_components_of(Entity e) {
 		for (ContainerInterface* reg : registry_list)
 			reg->remove(e);
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <cstring>
+#include <memory>
+#include <type_traits>
 #include <vector>
-#include <unordered_map>
 #include <set>
 #include <functional>
 #include <typeindex>
@@ -11,6 +13,12 @@
 #include "entity.hpp"
 
 
+// Saved contents of one container, see ComponentContainer::snapshot
+struct ContainerSnapshot
+{
+	virtual ~ContainerSnapshot() = default;
+};
+
 // Common interface to refer to all containers in the ECS registry
 struct ContainerInterface
 {
@@ -18,6 +26,8 @@ struct ContainerInterface
 	virtual size_t size() = 0;
 	virtual void remove(Entity e) = 0;
 	virtual bool has(Entity entity) = 0;
+	virtual std::unique_ptr<ContainerSnapshot> snapshot() = 0;
+	virtual void restore(const ContainerSnapshot& snapshot) = 0;
 };
 
 // A container that stores components of type 'Component' and associated entities
@@ -25,9 +35,69 @@ template <typename Component> // A component can be any class
 class ComponentContainer : public ContainerInterface
 {
 private:
-	// The hash map from Entity -> array index.
-	std::unordered_map<unsigned int, unsigned int> map_entity_componentID; // the entity is cast to uint to be hashable.
+	// The paged sparse index from Entity -> array index (the entity is cast to uint). A page covers INDEX_PAGE_SIZE
+	// consecutive ids, it is set up by the first insert into it and handed back once its last component is removed.
+	// Entity ids are never reused, so the pages follow the ids of the live components, not all ids ever created.
+	static constexpr unsigned int INDEX_PAGE_SIZE = 1024;
+	static constexpr unsigned int INVALID_INDEX = ~0u;
+	struct IndexPage
+	{
+		unsigned int slots[INDEX_PAGE_SIZE];
+		unsigned int used;
+	};
+	std::vector<std::unique_ptr<IndexPage>> index_pages;	// by id / INDEX_PAGE_SIZE, nullptr without components
+	std::vector<std::unique_ptr<IndexPage>> spare_pages;	// handed back pages, reused before allocating new ones
 	bool registered = false;
+
+	// the index of 'id', nullptr if it has no component
+	unsigned int* find_index(unsigned int id)
+	{
+		unsigned int page = id / INDEX_PAGE_SIZE;
+		if (page >= index_pages.size() || !index_pages[page])
+			return nullptr;
+		unsigned int* slot = &index_pages[page]->slots[id % INDEX_PAGE_SIZE];
+		return *slot == INVALID_INDEX ? nullptr : slot;
+	}
+
+	void set_index(unsigned int id, unsigned int index)
+	{
+		unsigned int page = id / INDEX_PAGE_SIZE;
+		if (page >= index_pages.size())
+			index_pages.resize(page + 1);
+		std::unique_ptr<IndexPage>& slots = index_pages[page];
+		if (!slots) {
+			if (spare_pages.empty()) {
+				slots = std::make_unique<IndexPage>();
+			}
+			else {
+				slots = std::move(spare_pages.back());
+				spare_pages.pop_back();
+			}
+			std::fill(std::begin(slots->slots), std::end(slots->slots), INVALID_INDEX);
+			slots->used = 0;
+		}
+		unsigned int& slot = slots->slots[id % INDEX_PAGE_SIZE];
+		if (slot == INVALID_INDEX)
+			slots->used++;
+		slot = index;
+	}
+
+	void erase_index(unsigned int id)
+	{
+		std::unique_ptr<IndexPage>& slots = index_pages[id / INDEX_PAGE_SIZE];
+		slots->slots[id % INDEX_PAGE_SIZE] = INVALID_INDEX;
+		if (--slots->used == 0)
+			spare_pages.push_back(std::move(slots));
+	}
+
+	void clear_index()
+	{
+		for (std::unique_ptr<IndexPage>& slots : index_pages) {
+			if (slots)
+				spare_pages.push_back(std::move(slots));
+		}
+		index_pages.clear();
+	}
 public:
 	// Container of all components of type 'Component'
 	std::vector<Component> components;
@@ -46,7 +116,7 @@ public:
 		// Usually, every entity should only have one instance of each component type
 		assert(!(check_for_duplicates && has(e)) && "Entity already contained in ECS registry");
 
-		map_entity_componentID[e] = (unsigned int)components.size();
+		set_index(e, (unsigned int)components.size());
 		components.push_back(std::move(c)); // the move enforces move instead of copy constructor
 		entities.push_back(e);
 		return components.back();
@@ -65,12 +135,12 @@ public:
 	// A wrapper to return the component of an entity
 	Component& get(Entity e) {
 		assert(has(e) && "Entity not contained in ECS registry");
-		return components[map_entity_componentID[e]];
+		return components[*find_index(e)];
 	}
 
 	// Check if entity has a component of type 'Component'
 	bool has(Entity entity) {
-		return map_entity_componentID.count(entity) > 0;
+		return find_index(entity) != nullptr;
 	}
 
 	// Remove an component and pack the container to re-use the empty space
@@ -79,16 +149,16 @@ public:
 		if (has(e))
 		{
 			// Get the current position
-			int cID = map_entity_componentID[e];
+			unsigned int cID = *find_index(e);
 
 			// Move the last element to position cID using the move operator
 			// Note, components[cID] = components.back() would trigger the copy instead of move operator
 			components[cID] = std::move(components.back());
 			entities[cID] = entities.back(); // the entity is only a single index, copy it.
-			map_entity_componentID[entities.back()] = cID;
+			*find_index(entities.back()) = cID;
 
 			// Erase the old component and free its memory
-			map_entity_componentID.erase(e);
+			erase_index(e);
 			components.pop_back();
 			entities.pop_back();
 			// Note, one could mark the id for re-use
@@ -98,11 +168,52 @@ public:
 	// Remove all components of type 'Component'
 	void clear()
 	{
-		map_entity_componentID.clear();
+		clear_index();
 		components.clear();
 		entities.clear();
 	}
 
+	// Make room for 'count' more components, e.g., before creating many entities at once
+	// The capacity grows geometrically, reserving exactly size() + count would reallocate on every small batch.
+	void reserve(size_t count)
+	{
+		const size_t needed = components.size() + count;
+		if (needed <= components.capacity())
+			return;
+		const size_t capacity = std::max(needed, 2 * components.capacity());
+		components.reserve(capacity);
+		entities.reserve(capacity);
+	}
+
+	// Copy of the components and entities, restore() puts them back
+	struct Snapshot : ContainerSnapshot
+	{
+		std::vector<Component> components;
+		std::vector<Entity> entities;
+	};
+
+	std::unique_ptr<ContainerSnapshot> snapshot()
+	{
+		auto snapshot = std::make_unique<Snapshot>();
+		snapshot->components = components;
+		snapshot->entities = entities;
+		return snapshot;
+	}
+
+	// Replace the contents by a snapshot of this container. Entities and trivially copyable components are copied
+	// with one memcpy each into the existing capacity, the old components are not destroyed one by one.
+	// The index is rebuilt from the restored entities, its pages are reused rather than freed and allocated again.
+	void restore(const ContainerSnapshot& snapshot)
+	{
+		const Snapshot& saved = static_cast<const Snapshot&>(snapshot);
+		copy_all(saved.components, components);
+		copy_all(saved.entities, entities);
+
+		clear_index();
+		for (unsigned int i = 0; i < entities.size(); i++)
+			set_index(entities[i], i);
+	}
+
 	// Report the number of components of type 'Component'
 	size_t size()
 	{
@@ -117,10 +228,25 @@ public:
 		std::sort(entities.begin(), entities.end(), comparisonFunction);
 		// Now re-arrange the components (Note, creates a new vector, which may be slow! Not sure if in-place could be faster: https://stackoverflow.com/questions/63703637/how-to-efficiently-permute-an-array-in-place-using-stdswap)
 		std::vector<Component> components_new; components_new.reserve(components.size());
-		std::transform(entities.begin(), entities.end(), std::back_inserter(components_new), [&](Entity e) { return std::move(get(e)); }); // note, the get still uses the old hash map (on purpose!)
+		std::transform(entities.begin(), entities.end(), std::back_inserter(components_new), [&](Entity e) { return std::move(get(e)); }); // note, the get still uses the old index (on purpose!)
 		components = std::move(components_new); // note, we use move operations to not create unneccesary copies of objects, but memory is still allocated for the new vector
-		// Fill the new hashmap
+		// Fill the new index
 		for (unsigned int i = 0; i < entities.size(); i++)
-			map_entity_componentID[entities[i]] = i;
+			set_index(entities[i], i);
+	}
+
+private:
+	template <typename T>
+	static void copy_all(const std::vector<T>& from, std::vector<T>& to)
+	{
+		if constexpr (std::is_trivially_copyable_v<T>) {
+			// keeps the capacity, a shrinking resize() of a trivial type just moves the end
+			to.resize(from.size());
+			if (!from.empty())
+				memcpy(to.data(), from.data(), from.size() * sizeof(T));
+		}
+		else {
+			to = from;
+		}
 	}
 };
@@ -0,0 +1,118 @@
+#pragma once
+
+// stlib
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+#include "common.hpp"
+#include "tinyECS/components.hpp"
+
+// Vertex attributes have the same location in every effect: they are bound to these names before linking,
+// so one vertex array per geometry serves all effects drawing it.
+enum class ATTRIBUTE_ID {
+	POSITION = 0,
+	TEXCOORD = POSITION + 1,
+	COLOR = TEXCOORD + 1,
+	INSTANCE_TRANSFORM = COLOR + 1,					// mat3, one location per column
+	INSTANCE_COLOR = INSTANCE_TRANSFORM + 3,
+	INSTANCE_LAYER = INSTANCE_COLOR + 1,
+	VELOCITY = INSTANCE_LAYER + 1,
+	ATTRIBUTE_COUNT = VELOCITY + 1
+};
+const int attribute_count = (int)ATTRIBUTE_ID::ATTRIBUTE_COUNT;
+
+// Make sure these names remain in sync with the associated enumerators, the columns of a matrix have none
+const std::array<const char*, attribute_count> attribute_names = {
+	"in_position",
+	"in_texcoord",
+	"in_color",
+	"in_transform", nullptr, nullptr,
+	"in_instance_color",
+	"in_instance_layer",
+	"in_velocity"
+};
+
+// One float vector attribute of a vertex
+struct VertexAttribute {
+	ATTRIBUTE_ID id;
+	GLint size;		// number of floats
+	size_t offset;	// in bytes from the start of the vertex
+};
+
+// The attribute of a vertex member of type Member, e.g., vec3
+template <typename Member>
+constexpr VertexAttribute vertex_attribute(ATTRIBUTE_ID id, size_t offset)
+{
+	static_assert(std::is_same<typename Member::value_type, float>::value, "Vertex attributes are floats");
+	return { id, (GLint)Member::length(), offset };
+}
+
+// The attributes of a vertex type, stored in a buffer of consecutive vertices. Specialized per vertex type.
+template <typename Vertex>
+struct VertexLayout;
+
+template <>
+struct VertexLayout<TexturedVertex> {
+	static constexpr std::array<VertexAttribute, 2> attributes = {
+		vertex_attribute<decltype(TexturedVertex::position)>(ATTRIBUTE_ID::POSITION, offsetof(TexturedVertex, position)),
+		vertex_attribute<decltype(TexturedVertex::texcoord)>(ATTRIBUTE_ID::TEXCOORD, offsetof(TexturedVertex, texcoord))
+	};
+};
+
+template <>
+struct VertexLayout<ColoredVertex> {
+	static constexpr std::array<VertexAttribute, 2> attributes = {
+		vertex_attribute<decltype(ColoredVertex::position)>(ATTRIBUTE_ID::POSITION, offsetof(ColoredVertex, position)),
+		vertex_attribute<decltype(ColoredVertex::color)>(ATTRIBUTE_ID::COLOR, offsetof(ColoredVertex, color))
+	};
+};
+
+// e.g., the screen triangle
+template <>
+struct VertexLayout<vec3> {
+	static constexpr std::array<VertexAttribute, 1> attributes = {
+		vertex_attribute<vec3>(ATTRIBUTE_ID::POSITION, 0)
+	};
+};
+
+template <>
+struct VertexLayout<SpriteInstance> {
+	static constexpr std::array<VertexAttribute, 5> attributes = {
+		vertex_attribute<vec3>(ATTRIBUTE_ID::INSTANCE_TRANSFORM, offsetof(SpriteInstance, transform)),
+		vertex_attribute<vec3>(ATTRIBUTE_ID((int)ATTRIBUTE_ID::INSTANCE_TRANSFORM + 1), offsetof(SpriteInstance, transform) + sizeof(vec3)),
+		vertex_attribute<vec3>(ATTRIBUTE_ID((int)ATTRIBUTE_ID::INSTANCE_TRANSFORM + 2), offsetof(SpriteInstance, transform) + 2 * sizeof(vec3)),
+		vertex_attribute<decltype(SpriteInstance::color)>(ATTRIBUTE_ID::INSTANCE_COLOR, offsetof(SpriteInstance, color)),
+		vertex_attribute<decltype(SpriteInstance::layer)>(ATTRIBUTE_ID::INSTANCE_LAYER, offsetof(SpriteInstance, layer))
+	};
+};
+
+template <>
+struct VertexLayout<ParticleVertex> {
+	static constexpr std::array<VertexAttribute, 2> attributes = {
+		vertex_attribute<decltype(ParticleVertex::position)>(ATTRIBUTE_ID::POSITION, offsetof(ParticleVertex, position)),
+		vertex_attribute<decltype(ParticleVertex::color)>(ATTRIBUTE_ID::COLOR, offsetof(ParticleVertex, color))
+	};
+};
+
+template <>
+struct VertexLayout<GpuParticle> {
+	static constexpr std::array<VertexAttribute, 3> attributes = {
+		vertex_attribute<decltype(GpuParticle::position)>(ATTRIBUTE_ID::POSITION, offsetof(GpuParticle, position)),
+		vertex_attribute<decltype(GpuParticle::color)>(ATTRIBUTE_ID::COLOR, offsetof(GpuParticle, color)),
+		vertex_attribute<decltype(GpuParticle::velocity)>(ATTRIBUTE_ID::VELOCITY, offsetof(GpuParticle, velocity))
+	};
+};
+
+// Points the attributes of the bound vertex array to the vertices in the bound GL_ARRAY_BUFFER, starting at
+// byte 'first'. A divisor of 1 advances the attributes per instance instead of per vertex.
+template <typename Vertex>
+void setVertexLayout(size_t first = 0, GLuint divisor = 0)
+{
+	for (const VertexAttribute& attribute : VertexLayout<Vertex>::attributes) {
+		glEnableVertexAttribArray((GLuint)attribute.id);
+		glVertexAttribPointer((GLuint)attribute.id, attribute.size, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+			(void*)(first + attribute.offset));
+		glVertexAttribDivisor((GLuint)attribute.id, divisor);
+	}
+}
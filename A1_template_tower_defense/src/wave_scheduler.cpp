@@ -0,0 +1,144 @@
+// internal
+#include "wave_scheduler.hpp"
+
+// stlib
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "random.hpp"
+
+bool WaveScheduler::load(const std::string& path)
+{
+	timeline.clear();
+	wave_start_ms.clear();
+	duration_ms = 0.f;
+	reset();
+	if (compile(path))
+		return true;
+
+	// no partial waves, a broken file spawns nothing
+	timeline.clear();
+	wave_start_ms.clear();
+	duration_ms = 0.f;
+	return false;
+}
+
+bool WaveScheduler::compile(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.good()) {
+		fprintf(stderr, "Failed to open wave file %s\n", path.c_str());
+		return false;
+	}
+
+	RandomStream rng(0, 0, 0, RNG_PURPOSE::WAVE_SPAWN);
+	float wave_duration_ms = 0.f;
+
+	std::string line;
+	for (int line_number = 1; std::getline(file, line); line_number++) {
+		std::stringstream ss(line.substr(0, line.find('#')));
+		std::string keyword;
+		if (!(ss >> keyword))
+			continue;
+
+		if (keyword == "seed") {
+			unsigned int seed;
+			if (!(ss >> seed)) {
+				fprintf(stderr, "%s:%d: expected 'seed <n>'\n", path.c_str(), line_number);
+				return false;
+			}
+			rng = RandomStream(seed, 0, 0, RNG_PURPOSE::WAVE_SPAWN);
+		}
+		else if (keyword == "wave") {
+			// the new wave starts when the previous one ended
+			duration_ms += wave_duration_ms;
+			if (!(ss >> wave_duration_ms) || wave_duration_ms <= 0.f) {
+				fprintf(stderr, "%s:%d: expected 'wave <duration_ms>'\n", path.c_str(), line_number);
+				return false;
+			}
+			wave_start_ms.push_back(duration_ms);
+		}
+		else if (keyword == "spawn") {
+			float start_ms, interval_ms;
+			int count;
+			std::string type, row;
+			if (!(ss >> start_ms >> count >> interval_ms >> type >> row) || start_ms < 0.f || count < 0 || interval_ms < 0.f) {
+				fprintf(stderr, "%s:%d: expected 'spawn <start_ms> <count> <interval_ms> <type> <row>'\n", path.c_str(), line_number);
+				return false;
+			}
+			if (wave_start_ms.empty()) {
+				fprintf(stderr, "%s:%d: spawn outside of a wave\n", path.c_str(), line_number);
+				return false;
+			}
+			if (count > 0 && start_ms + (count - 1) * interval_ms >= wave_duration_ms) {
+				fprintf(stderr, "%s:%d: spawns last longer than their wave\n", path.c_str(), line_number);
+				return false;
+			}
+
+			int fixed_type = type == "blue" ? 0 : type == "green" ? 1 : -1;
+			int fixed_row = row == "any" ? -1 : atoi(row.c_str());
+			if ((fixed_type < 0 && type != "any") || (fixed_row != -1 && (fixed_row < 1 || fixed_row >= GRID_ROWS))) {
+				fprintf(stderr, "%s:%d: unknown invader type '%s' or row '%s'\n", path.c_str(), line_number, type.c_str(), row.c_str());
+				return false;
+			}
+
+			// resolve all random choices now, in file order
+			for (int i = 0; i < count; i++) {
+				int invader_type = fixed_type >= 0 ? fixed_type : rng.next_int(2);
+				int invader_row = fixed_row >= 0 ? fixed_row : 1 + rng.next_int(GRID_ROWS - 1);
+				SpawnEvent spawn;
+				spawn.time_ms = duration_ms + start_ms + i * interval_ms;
+				spawn.position = { GRID_CELL_WIDTH_PX / 2, invader_row * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2 };
+				spawn.invader_type = invader_type;
+				timeline.push_back(spawn);
+			}
+		}
+		else {
+			fprintf(stderr, "%s:%d: unknown keyword '%s'\n", path.c_str(), line_number, keyword.c_str());
+			return false;
+		}
+	}
+	duration_ms += wave_duration_ms;
+
+	if (wave_start_ms.empty()) {
+		fprintf(stderr, "Wave file %s has no waves\n", path.c_str());
+		return false;
+	}
+
+	// spawns of overlapping groups interleave, equal times keep their file order
+	std::stable_sort(timeline.begin(), timeline.end(), [](const SpawnEvent& a, const SpawnEvent& b) { return a.time_ms < b.time_ms; });
+
+	printf("Loaded %d waves with %d spawns from %s\n", (int)wave_start_ms.size(), (int)timeline.size(), path.c_str());
+	return true;
+}
+
+void WaveScheduler::reset()
+{
+	clock_ms = 0.f;
+	cursor = 0;
+	wave = 0;
+}
+
+size_t WaveScheduler::advance(float elapsed_ms, const SpawnEvent*& first)
+{
+	// all spawns are out and the last wave is over, start over with the first wave
+	// spawns due right after the wrap around are handed out by the next call
+	if (duration_ms > 0.f && cursor == timeline.size() && clock_ms >= duration_ms) {
+		clock_ms -= duration_ms;
+		cursor = 0;
+		wave = 0;
+	}
+
+	clock_ms += elapsed_ms;
+	while (wave + 1 < (int)wave_start_ms.size() && wave_start_ms[wave + 1] <= clock_ms)
+		wave++;
+
+	// the timeline is sorted, the due spawns are the ones between the old and the new cursor
+	size_t begin = cursor;
+	while (cursor < timeline.size() && timeline[cursor].time_ms <= clock_ms)
+		cursor++;
+
+	first = timeline.data() + begin;
+	return cursor - begin;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// stlib
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+// A single invader spawn of the compiled timeline
+struct SpawnEvent {
+	float time_ms;		// since the start of the first wave
+	vec2 position;
+	int invader_type;
+};
+
+// Invader waves are defined in data/waves (see the comments in waves.txt for the format).
+// Loading compiles all waves into one flat timeline of spawns sorted by time, with every random
+// choice already made, so that a wave file always produces the same spawns.
+// At runtime the scheduler only moves a cursor over the timeline, the spawns that came due in a
+// frame are handed out as one contiguous range. The timeline repeats once the last wave ended.
+class WaveScheduler
+{
+public:
+	bool load(const std::string& path);
+
+	// restart at the beginning of the first wave
+	void reset();
+
+	// advance the clock, returns the number of spawns that came due and points 'first' at them
+	size_t advance(float elapsed_ms, const SpawnEvent*& first);
+
+	size_t size() const { return timeline.size(); }
+	int get_wave() const { return wave; }
+	// time since the current wave started
+	float get_wave_time_ms() const { return wave_start_ms.empty() ? clock_ms : clock_ms - wave_start_ms[wave]; }
+
+private:
+	bool compile(const std::string& path);
+
+	std::vector<SpawnEvent> timeline;
+	std::vector<float> wave_start_ms;	// per wave
+	float duration_ms = 0.f;			// of all waves
+
+	float clock_ms = 0.f;
+	size_t cursor = 0;
+	int wave = 0;
+};
@@ -1,5 +1,9 @@
 #include "world_init.hpp"
 #include "tinyECS/registry.hpp"
+#include "influence_map.hpp"
+#include "particle_system.hpp"
+#include "random.hpp"
+#include <cstring>
 #include <iostream>
 
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -21,7 +25,8 @@ Entity createGridLine(vec2 start_pos, vec2 end_pos)
 		{
 			TEXTURE_ASSET_ID::TEXTURE_COUNT,
 			EFFECT_ASSET_ID::EGG,
-			GEOMETRY_BUFFER_ID::DEBUG_LINE
+			GEOMETRY_BUFFER_ID::DEBUG_LINE,
+			RENDER_LAYER::GRID
 		}
 	);
 
@@ -34,66 +39,123 @@ Entity createGridLine(vec2 start_pos, vec2 end_pos)
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // !!! TODO A1: implement grid lines as gridLines with renderRequests and colors
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-Entity createInvader(RenderSystem* renderer, vec2 position, int invader_type)
-{
-	// reserve an entity
-	auto entity = Entity();
+namespace {
+	// every invader walks and is animated, its type specific values are set by init_invader()
+	auto invader_prefab()
+	{
+		Motion motion;
+		motion.angle = 0.f;
+		// resize, set scale to negative if you want to make it face the opposite way
+		motion.scale = vec2({ INVADER_BB_WIDTH, INVADER_BB_HEIGHT });
+
+		AIAgent agent;
+		agent.tree = BEHAVIOR_TREE_ID::INVADER;
+
+		Animation animation;
+		animation.is_walking = true;
+		animation.current_frame = 0;
+		animation.total_frames = 3;
+
+		// the (empty) Eatable component refers to all invaders
+		return make_prefab(
+			prefab_part(registry.invaders),
+			prefab_part(registry.motions, motion),
+			prefab_part(registry.renderRequests, { TEXTURE_ASSET_ID::INVADER_IDLE_BLUE, EFFECT_ASSET_ID::TEXTURED, GEOMETRY_BUFFER_ID::SPRITE, RENDER_LAYER::INVADERS }),
+			prefab_part(registry.animations, animation),
+			prefab_part(registry.aiAgents, agent),
+			prefab_part(registry.eatables)
+		);
+	}
+	const auto INVADER_PREFAB = invader_prefab();
 
-	// invader health
-	Invader& invader = registry.invaders.emplace(entity);
-	if (invader_type == 0) {
-		invader.health = INVADER_BLUE_HEALTH;
-	} else if (invader_type == 1) {
-		invader.health = INVADER_GREEN_HEALTH;
+	// check for invader type so we can set health, speed and texture
+	void init_invader(Invader& invader, Motion& motion, RenderRequest& render_request, vec2 position, int invader_type)
+	{
+		invader.type = invader_type;
+		if (invader_type == 0) {
+			invader.health = INVADER_BLUE_HEALTH;
+			motion.velocity = { INVADER_SPEED_BLUE, 0 };
+			render_request.used_texture = TEXTURE_ASSET_ID::INVADER_IDLE_BLUE;
+		} else if (invader_type == 1) {
+			invader.health = INVADER_GREEN_HEALTH;
+			motion.velocity = { INVADER_SPEED_GREEN, 0 };
+			render_request.used_texture = TEXTURE_ASSET_ID::INVADER_GREEN_ONE;
+		}
+		motion.position = position;
+		invader.influence_cell = influence_map.add_invader(position);
 	}
 
-	// store a reference to the potentially re-used mesh object
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.meshPtrs.emplace(entity, &mesh);
+	const auto PROJECTILE_PREFAB = make_prefab(
+		prefab_part(registry.projectiles, { PROJECTILE_DAMAGE }),
+		prefab_part(registry.motions),
+		prefab_part(registry.renderRequests, { TEXTURE_ASSET_ID::PROJECTILE, EFFECT_ASSET_ID::TEXTURED, GEOMETRY_BUFFER_ID::SPRITE, RENDER_LAYER::PROJECTILES })
+	);
 
-	// TODO A1: initialize the position, scale, and physics components
-	// check for invader type so we can set speed 
-	auto& motion = registry.motions.emplace(entity);
-	motion.angle = 0.f;
-	if (invader_type == 0) {
-		motion.velocity = { INVADER_SPEED_BLUE, 0 };
-		invader.type = invader_type;
-	} else if (invader_type == 1) {
-		motion.velocity = { INVADER_SPEED_GREEN, 0 };
-		invader.type = invader_type;
+	const auto EXPLOSION_PREFAB = make_prefab(
+		prefab_part(registry.explosions)
+	);
+
+	auto invader_pool = make_pool(INVADER_PREFAB, INVADER_POOL_SIZE);
+	auto projectile_pool = make_pool(PROJECTILE_PREFAB, PROJECTILE_POOL_SIZE);
+	auto explosion_pool = make_pool(EXPLOSION_PREFAB, EXPLOSION_POOL_SIZE);
+}
+
+void set_pool_capacity(POOL_ID pool, size_t capacity)
+{
+	switch (pool) {
+	case POOL_ID::PROJECTILE: projectile_pool.set_capacity(capacity); break;
+	case POOL_ID::INVADER: invader_pool.set_capacity(capacity); break;
+	case POOL_ID::EXPLOSION: explosion_pool.set_capacity(capacity); break;
+	default: break;
 	}
-	motion.position = position;
+}
 
-	// resize, set scale to negative if you want to make it face the opposite way
-	// motion.scale = vec2({ -INVADER_BB_WIDTH, INVADER_BB_WIDTH });
-	motion.scale = vec2({ INVADER_BB_WIDTH, INVADER_BB_HEIGHT });
-
-	// create an (empty) Bug component to be able to refer to all bug
-	registry.eatables.emplace(entity);
-	if (invader.type == 0) {
-		registry.renderRequests.insert(
-			entity,
-			{
-				TEXTURE_ASSET_ID::INVADER_IDLE_BLUE,
-				EFFECT_ASSET_ID::TEXTURED,
-				GEOMETRY_BUFFER_ID::SPRITE
-			}
-		);
-	} else if (invader.type == 1) {
-		registry.renderRequests.insert(
-			entity,
-			{
-				TEXTURE_ASSET_ID::INVADER_GREEN_ONE,
-				EFFECT_ASSET_ID::TEXTURED,
-				GEOMETRY_BUFFER_ID::SPRITE
-			}
-		);
+const PoolStats& get_pool_stats(POOL_ID pool)
+{
+	switch (pool) {
+	case POOL_ID::INVADER: return invader_pool.get_stats();
+	case POOL_ID::EXPLOSION: return explosion_pool.get_stats();
+	default: return projectile_pool.get_stats();
 	}
+}
 
-	return entity;
+const char* get_pool_name(POOL_ID pool)
+{
+	const char* pool_names[pool_count] = { "projectile", "invader", "explosion" };
+	return pool_names[(int)pool];
+}
+
+bool find_pool(const char* name, POOL_ID& pool)
+{
+	for (int i = 0; i < pool_count; i++) {
+		if (strcmp(name, get_pool_name((POOL_ID)i)) == 0) {
+			pool = (POOL_ID)i;
+			return true;
+		}
+	}
+	fprintf(stderr, "Unknown entity pool %s\n", name);
+	return false;
 }
 
-Entity createTower(RenderSystem* renderer, vec2 position)
+Entity createInvader(vec2 position, int invader_type)
+{
+	return invader_pool.acquire(
+		[&](Entity, Invader& invader, Motion& motion, RenderRequest& render_request, Animation&, AIAgent&, Eatable&) {
+			init_invader(invader, motion, render_request, position, invader_type);
+		});
+}
+
+void createInvaders(const SpawnEvent* spawns, size_t count)
+{
+	// wave invaders animate faster than the ones placed by hand
+	invader_pool.acquire_batch(count,
+		[spawns](size_t i, Entity, Invader& invader, Motion& motion, RenderRequest& render_request, Animation& animation, AIAgent&, Eatable&) {
+			init_invader(invader, motion, render_request, spawns[i].position, spawns[i].invader_type);
+			animation.frame_duration = 0.1f;
+		});
+}
+
+Entity createTower(vec2 position)
 {
 	auto entity = Entity();
 
@@ -101,10 +163,7 @@ Entity createTower(RenderSystem* renderer, vec2 position)
 	auto& t = registry.towers.emplace(entity);
 	t.range = (float)WINDOW_WIDTH_PX / (float)GRID_CELL_WIDTH_PX;
 	t.timer_ms = TOWER_TIMER_MS;	
-
-	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.meshPtrs.emplace(entity, &mesh);
+	registry.aiAgents.emplace(entity).tree = BEHAVIOR_TREE_ID::TOWER;
 
 	// Initialize the motion
 	auto& motion = registry.motions.emplace(entity);
@@ -113,6 +172,7 @@ Entity createTower(RenderSystem* renderer, vec2 position)
 	motion.position = position;
 
 	std::cout << "INFO: tower position: " << position.x << ", " << position.y << std::endl;
+	influence_map.add_tower(position, t.range);
 
 	// scale is negative to make it face the opposite way
 	motion.scale = vec2({ -TOWER_BB_WIDTH, TOWER_BB_HEIGHT });
@@ -124,7 +184,8 @@ Entity createTower(RenderSystem* renderer, vec2 position)
 		{
 			TEXTURE_ASSET_ID::TOWER,
 			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::TOWERS
 		}
 	);
 
@@ -139,39 +200,87 @@ void removeTower(vec2 position) {
 		
 		if (tower_motion.position.y == position.y) {
 			// remove this tower
-			registry.remove_all_components_of(tower_entity);
+			destroyTower(tower_entity);
 			std::cout << "tower removed" << std::endl;
 		}
 	}
 }
 
+void destroyTower(Entity tower_entity) {
+	influence_map.remove_tower(registry.motions.get(tower_entity).position, registry.towers.get(tower_entity).range);
+	registry.remove_all_components_of(tower_entity);
+}
+
+void destroyInvader(Entity invader_entity) {
+	influence_map.remove_invader(registry.invaders.get(invader_entity).influence_cell);
+	invader_pool.release(invader_entity);
+}
+
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // !!! TODO A1: create a new projectile w/ pos, size, & velocity
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 Entity createProjectile(vec2 pos, vec2 size, vec2 velocity)
 {
-	auto entity = Entity();
+	return projectile_pool.acquire(
+		[&](Entity, Projectile&, Motion& motion, RenderRequest&) {
+			motion.position = pos;
+			motion.velocity = velocity;
+			motion.scale = size;
+		});
+}
 
-	// TODO: projectile
-	// TODO: motion
-	// TODO: renderRequests
-	registry.projectiles.emplace(entity).damage = PROJECTILE_DAMAGE;
+void createProjectiles(const vec2* positions, size_t count, vec2 size, vec2 velocity)
+{
+	projectile_pool.acquire_batch(count,
+		[&](size_t i, Entity, Projectile&, Motion& motion, RenderRequest&) {
+			motion.position = positions[i];
+			motion.velocity = velocity;
+			motion.scale = size;
+		});
+}
 
-	auto& motion = registry.motions.emplace(entity);
-	motion.position = pos;
-	motion.velocity = velocity;
-	motion.scale = size;
+void destroyProjectile(Entity projectile_entity)
+{
+	projectile_pool.release(projectile_entity);
+}
 
-	registry.renderRequests.insert(
-		entity,
-		{
-			TEXTURE_ASSET_ID::PROJECTILE,
-			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE
+// explosion after a collision, made of particles
+Entity createExplosion(vec2 position, vec4 color, int num_particles)
+{
+	return explosion_pool.acquire([&](Entity entity, Explosion& explosion) {
+		explosion.color = color;
+		explosion.has_range = particle_pool.allocate(num_particles, explosion.first);
+		if (!explosion.has_range)
+			return; // no particles left, the explosion is removed in the next step
+
+		// initialize particles in the explosion, angles and speeds are drawn in bulk into the velocity arrays
+		explosion.count = num_particles;
+		float* angles = particle_pool.velocity_x.data() + explosion.first;
+		float* speeds = particle_pool.velocity_y.data() + explosion.first;
+		RandomStream rng = random_service.stream(entity.id(), RNG_PURPOSE::EXPLOSION);
+		rng.fill(angles, explosion.count, 0.f, 2 * M_PI);
+		rng.fill(speeds, explosion.count, 50.f, 150.f);
+		for (unsigned int i = explosion.first; i < explosion.first + explosion.count; ++i) {
+			float angle = particle_pool.velocity_x[i];
+			float speed = particle_pool.velocity_y[i];
+
+			particle_pool.position_x[i] = position.x;
+			particle_pool.position_y[i] = position.y;
+			particle_pool.velocity_x[i] = cos(angle) * speed;
+			particle_pool.velocity_y[i] = sin(angle) * speed;
+			particle_pool.life[i] = 1.0f;
 		}
-	);
+		if (particle_pool.simulate_on_gpu)
+			particle_pool.spawn_on_gpu(explosion.first, explosion.count, color);
+	});
+}
 
-	return entity;
+void destroyExplosion(Entity explosion_entity)
+{
+	Explosion& explosion = registry.explosions.get(explosion_entity);
+	if (explosion.has_range)
+		particle_pool.release(explosion.first);
+	explosion_pool.release(explosion_entity);
 }
 
 Entity createLine(vec2 position, vec2 scale)
@@ -185,7 +294,8 @@ Entity createLine(vec2 position, vec2 scale)
 			// usage TEXTURE_COUNT when no texture is needed, i.e., an .obj or other vertices are used instead
 			TEXTURE_ASSET_ID::TEXTURE_COUNT,
 			EFFECT_ASSET_ID::EGG,
-			GEOMETRY_BUFFER_ID::DEBUG_LINE
+			GEOMETRY_BUFFER_ID::DEBUG_LINE,
+			RENDER_LAYER::DEBUG
 		}
 	);
 
@@ -201,12 +311,11 @@ Entity createLine(vec2 position, vec2 scale)
 }
 
 // LEGACY
-Entity createChicken(RenderSystem* renderer, vec2 pos)
+Entity createChicken(Mesh& mesh, vec2 pos)
 {
 	auto entity = Entity();
 
-	// Store a reference to the potentially re-used mesh object
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::CHICKEN);
+	// Store a reference to the potentially re-used mesh object (see RenderSystem::getMesh)
 	registry.meshPtrs.emplace(entity, &mesh);
 
 	// Setting initial motion values
@@ -225,7 +334,8 @@ Entity createChicken(RenderSystem* renderer, vec2 pos)
 			// usage TEXTURE_COUNT when no texture is needed, i.e., an .obj or other vertices are used instead
 			TEXTURE_ASSET_ID::TEXTURE_COUNT,
 			EFFECT_ASSET_ID::CHICKEN,
-			GEOMETRY_BUFFER_ID::CHICKEN
+			GEOMETRY_BUFFER_ID::CHICKEN,
+			RENDER_LAYER::INVADERS
 		}
 	);
 
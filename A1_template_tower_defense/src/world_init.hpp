@@ -2,17 +2,47 @@
 
 #include "common.hpp"
 #include "tinyECS/tiny_ecs.hpp"
-#include "render_system.hpp"
+#include "tinyECS/components.hpp"
+#include "wave_scheduler.hpp"
+#include "entity_pool.hpp"
 
 // invaders
-Entity createInvader(RenderSystem* renderer, vec2 position, int invader_type);
+Entity createInvader(vec2 position, int invader_type);
+// walking invaders of the wave timeline, all created in one batch
+void createInvaders(const SpawnEvent* spawns, size_t count);
 
 // towers
-Entity createTower(RenderSystem* renderer, vec2 position);
+Entity createTower(vec2 position);
 void removeTower(vec2 position);
+void destroyTower(Entity tower_entity);
+
+// removes an invader and its influence
+void destroyInvader(Entity invader_entity);
 
 // projectile
 Entity createProjectile(vec2 pos, vec2 size, vec2 velocity);
+// projectiles of the same size and velocity, all created in one batch
+void createProjectiles(const vec2* positions, size_t count, vec2 size, vec2 velocity);
+void destroyProjectile(Entity projectile_entity);
+
+// particle explosion after a collision
+Entity createExplosion(vec2 position, vec4 color, int num_particles);
+void destroyExplosion(Entity explosion_entity);
+
+// Projectiles, invaders and explosions are recycled by entity pools, use the destroy functions above to remove them
+enum class POOL_ID {
+	PROJECTILE = 0,
+	INVADER = PROJECTILE + 1,
+	EXPLOSION = INVADER + 1,
+	POOL_COUNT = EXPLOSION + 1
+};
+const int pool_count = (int)POOL_ID::POOL_COUNT;
+
+void set_pool_capacity(POOL_ID pool, size_t capacity);
+const PoolStats& get_pool_stats(POOL_ID pool);
+const char* get_pool_name(POOL_ID pool);
+// looks up a pool by its name, e.g. for the --pool option
+bool find_pool(const char* name, POOL_ID& pool);
 
 // grid lines to show tile positions
 Entity createGridLine(vec2 start_pos, vec2 end_pos);
@@ -22,4 +52,4 @@ Entity createLine(vec2 position, vec2 size);
 
 // legacy
 // the player
-Entity createChicken(RenderSystem* renderer, vec2 position);
\ No newline at end of file
+Entity createChicken(Mesh& mesh, vec2 position);
\ No newline at end of file
@@ -4,137 +4,51 @@
 
 // stlib
 #include <cassert>
-#include <sstream>
 #include <iostream>
+#include <random>
 
 #include "physics_system.hpp"
+#include "influence_map.hpp"
+#include "particle_system.hpp"
+#include "random.hpp"
+#include "job_system.hpp"
+#include "events.hpp"
 
 // create the world
 WorldSystem::WorldSystem() :
 	points(0),
-	max_towers(MAX_TOWERS_START),
-	next_invader_spawn(0),
-	invader_spawn_rate_ms(INVADER_SPAWN_RATE_MS)
+	max_towers(MAX_TOWERS_START)
 {
 	// seeding rng with random device
-	rng = std::default_random_engine(std::random_device()());
+	seed = std::random_device()();
 }
 
 WorldSystem::~WorldSystem() {
-	// Destroy music components
-	if (background_music != nullptr)
-		Mix_FreeMusic(background_music);
-	if (chicken_dead_sound != nullptr)
-		Mix_FreeChunk(chicken_dead_sound);
-	if (chicken_eat_sound != nullptr)
-		Mix_FreeChunk(chicken_eat_sound);
-	Mix_CloseAudio();
+	// Close the recording with the final state
+	recorder.stop(state_hash());
 
 	// Destroy all created components
 	registry.clear_all_components();
 
 	// Close the window
-	glfwDestroyWindow(window);
-}
-
-// Debugging
-namespace {
-	void glfw_err_cb(int error, const char *desc) {
-		std::cerr << error << ": " << desc << std::endl;
-	}
-}
-
-// call to close the window, wrapper around GLFW commands
-void WorldSystem::close_window() {
-	glfwSetWindowShouldClose(window, GLFW_TRUE);
-}
-
-// World initialization
-// Note, this has a lot of OpenGL specific things, could be moved to the renderer
-GLFWwindow* WorldSystem::create_window() {
-
-	///////////////////////////////////////
-	// Initialize GLFW
-	glfwSetErrorCallback(glfw_err_cb);
-	if (!glfwInit()) {
-		std::cerr << "ERROR: Failed to initialize GLFW in world_system.cpp" << std::endl;
-		return nullptr;
-	}
-
-	//-------------------------------------------------------------------------
-	// If you are on Linux or Windows, you can change these 2 numbers to 4 and 3 and
-	// enable the glDebugMessageCallback to have OpenGL catch your mistakes for you.
-	// GLFW / OGL Initialization
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
-#if __APPLE__
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-	// CK: setting GLFW_SCALE_TO_MONITOR to true will rescale window but then you must handle different scalings
-	// glfwWindowHint(GLFW_SCALE_TO_MONITOR, GL_TRUE);		// GLFW 3.3+
-	glfwWindowHint(GLFW_SCALE_TO_MONITOR, GL_FALSE);		// GLFW 3.3+
-
-	// Create the main window (for rendering, keyboard, and mouse input)
-	window = glfwCreateWindow(WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX, "Towers vs Invaders Assignment", nullptr, nullptr);
-	if (window == nullptr) {
-		std::cerr << "ERROR: Failed to glfwCreateWindow in world_system.cpp" << std::endl;
-		return nullptr;
-	}
-
-	// Setting callbacks to member functions (that's why the redirect is needed)
-	// Input is handled using GLFW, for more info see
-	// http://www.glfw.org/docs/latest/input_guide.html
-	glfwSetWindowUserPointer(window, this);
-	auto key_redirect = [](GLFWwindow* wnd, int _0, int _1, int _2, int _3) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_key(_0, _1, _2, _3); };
-	auto cursor_pos_redirect = [](GLFWwindow* wnd, double _0, double _1) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_mouse_move({ _0, _1 }); };
-	auto mouse_button_pressed_redirect = [](GLFWwindow* wnd, int _button, int _action, int _mods) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_mouse_button_pressed(_button, _action, _mods); };
-	
-	glfwSetKeyCallback(window, key_redirect);
-	glfwSetCursorPosCallback(window, cursor_pos_redirect);
-	glfwSetMouseButtonCallback(window, mouse_button_pressed_redirect);
-
-	return window;
+	destroy_window();
 }
 
 bool WorldSystem::start_and_load_sounds() {
-	
-	//////////////////////////////////////
-	// Loading music and sounds with SDL
-	if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-		fprintf(stderr, "Failed to initialize SDL Audio");
-		return false;
-	}
-
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == -1) {
-		fprintf(stderr, "Failed to open audio device");
-		return false;
-	}
-
-	background_music = Mix_LoadMUS(audio_path("music.wav").c_str());
-	chicken_dead_sound = Mix_LoadWAV(audio_path("chicken_dead.wav").c_str());
-	chicken_eat_sound = Mix_LoadWAV(audio_path("chicken_eat.wav").c_str());
-
-	if (background_music == nullptr || chicken_dead_sound == nullptr || chicken_eat_sound == nullptr) {
-		fprintf(stderr, "Failed to load sounds\n %s\n %s\n %s\n make sure the data directory is present",
-			audio_path("music.wav").c_str(),
-			audio_path("chicken_dead.wav").c_str(),
-			audio_path("chicken_eat.wav").c_str());
-		return false;
-	}
-
-	return true;
+	return audio.init();
 }
 
-void WorldSystem::init(RenderSystem* renderer_arg) {
+void WorldSystem::init() {
 
-	this->renderer = renderer_arg;
+	random_service.set_seed(seed);
+	random_service.set_tick(0);
 
 	// start playing background music indefinitely
 	std::cout << "Starting music..." << std::endl;
-	Mix_PlayMusic(background_music, -1);
+	audio.play_music();
+
+	if (!waves.load(wave_file))
+		std::cerr << "ERROR: Failed to load invader waves, no invaders will spawn." << std::endl;
 
 	// Set all states to default
     restart_game();
@@ -144,14 +58,47 @@ void WorldSystem::init(RenderSystem* renderer_arg) {
 bool WorldSystem::step(float elapsed_ms_since_last_update) {
 
 	// Updating window title with points
-	std::stringstream title_ss;
-	title_ss << "Points: " << points;
-	glfwSetWindowTitle(window, title_ss.str().c_str());
+	update_window_title();
+
+	recorder.tick(elapsed_ms_since_last_update);
+	random_service.set_tick(random_service.get_tick() + 1);
+
+	// remove the explosions that finished in the last step, backwards since they are removed from the container
+	for (int i = (int)registry.explosions.size() - 1; i >= 0; --i) {
+		Explosion& explosion = registry.explosions.components[i];
+
+		// if no particles, explosion should be removed
+		if (explosion.count == 0 || explosion.timer >= explosion.duration) {
+			destroyExplosion(registry.explosions.entities[i]);
+		}
+	}
 
 	// Remove debug info from the last step
 	while (registry.debugComponents.entities.size() > 0)
 	    registry.remove_all_components_of(registry.debugComponents.entities.back());
 
+	// advance the threat map, in debug mode show it (red) and the tower placement advice (green)
+	influence_map.step(elapsed_ms_since_last_update);
+	if (debugging.in_debug_mode) {
+		const InfluenceSnapshot& influence = influence_map.snapshot();
+		for (int row = 0; row < GRID_ROWS; row++) {
+			for (int col = 0; col < GRID_COLS; col++) {
+				float threat = influence.threat[influence_index(col, row)];
+				if (threat < INFLUENCE_DEBUG_THRESHOLD)
+					continue;
+				vec2 center = { col * GRID_CELL_WIDTH_PX + GRID_CELL_WIDTH_PX / 2, row * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2 };
+				Entity cell = createLine(center, vec2(GRID_CELL_WIDTH_PX, GRID_CELL_HEIGHT_PX) * std::min(threat, 1.f));
+				registry.colors.insert(cell, { 1.f, 0.3f, 0.3f });
+			}
+		}
+		int advised_row = influence.best_tower_row();
+		if (advised_row >= 0) {
+			vec2 center = { (GRID_COLS - 1) * GRID_CELL_WIDTH_PX + GRID_CELL_WIDTH_PX / 2, advised_row * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2 };
+			Entity cell = createLine(center, vec2(GRID_CELL_WIDTH_PX / 3, GRID_CELL_HEIGHT_PX / 3));
+			registry.colors.insert(cell, { 0.2f, 0.8f, 0.2f });
+		}
+	}
+
 	// Removing out of screen entities
 	auto& motions_registry = registry.motions;
 	//  entities that leave the screen on the right side
@@ -164,7 +111,9 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 			game_over = true; 
 		}
 		if (motion.position.x + abs(motion.scale.x) < 0.f) {
-			if(!registry.players.has(motions_registry.entities[i])) // don't remove the player
+			if (registry.projectiles.has(entity))
+				destroyProjectile(entity);
+			else if(!registry.players.has(motions_registry.entities[i])) // don't remove the player
 				registry.remove_all_components_of(motions_registry.entities[i]);
 		}
 		ScreenState& screen = registry.screenStates.components[0];
@@ -179,65 +128,16 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 
 	}
 
-	// walking animation
-	for (Entity entity : registry.invaders.entities) {
-		Invader invader = registry.invaders.get(entity);
-		if (registry.animations.has(entity)) {
-			Animation& anim = registry.animations.get(entity);
-			anim.timer += elapsed_ms_since_last_update / 1000.0f;
-
-			if (anim.timer >= anim.frame_duration) {
-				anim.timer = 0.0f;
-    	        anim.current_frame = (anim.current_frame + 1) % anim.total_frames; 
-				RenderRequest& render_request = registry.renderRequests.get(entity);
-				if (invader.type == 0) {
-					if (anim.current_frame == 0) {
-						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_IDLE_BLUE;
-					} else if (anim.current_frame == 1) {
-						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_WALKING_BLUE;
-					} else {
-						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_RUNNING_BLUE;
-					}
-				} else if (invader.type == 1) {
-					if (anim.current_frame == 0) {
-						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_GREEN_ONE;
-					} else if (anim.current_frame == 1) {
-						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_GREEN_TWO;
-					} else {
-						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_GREEN_THREE;
-					}
-				}
-			}
-		}
-	}
-
-	// spawn new invaders
-	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	// TODO A1: limit them to cells on the far-left, except (0, 0)
-	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	next_invader_spawn -= ((int)(elapsed_ms_since_last_update* current_speed));
-	if (next_invader_spawn < 0.f) {
-		if (!game_over) {
-			// reset timer
-			next_invader_spawn = ((int)((INVADER_SPAWN_RATE_MS / 2) + uniform_dist(rng) * (INVADER_SPAWN_RATE_MS / 2)));
-
-			int total_rows = WINDOW_HEIGHT_PX / GRID_CELL_HEIGHT_PX;
-			int row = 1 + (rand() % (total_rows - 1));
-			int col = 0;
-
-			// create invader with random initial position
-			Entity invader = createInvader(renderer, vec2(
-				col * GRID_CELL_WIDTH_PX + GRID_CELL_WIDTH_PX / 2,
-				row * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2
-			),
-			(rand() % 2));
-			Animation& animation = registry.animations.emplace(invader);
-			animation.frame_duration = 0.1f;
-			animation.is_walking = true;
-			animation.current_frame = 0;
-			animation.total_frames = 3; 
-		}
+	// spawn the invaders of the current wave that came due, all at once
+	if (!game_over) {
+		const SpawnEvent* spawns;
+		size_t num_spawns = waves.advance(elapsed_ms_since_last_update * current_speed, spawns);
+		createInvaders(spawns, num_spawns);
 	}
+	if ((fast_forward.get_mode() == FAST_FORWARD_MODE::UNTIL_WAVE_END && waves.get_wave() != fast_forward_wave) || game_over)
+		fast_forward.set_mode(FAST_FORWARD_MODE::OFF);
+	collision_events.clear();
+	damage_events.clear();
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 	// TODO A1: game over fade out
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -270,7 +170,14 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 			screen.apply_vignette = 0;   
 			vignette_duration = 1000.0f; 
 		}
+
+		// fades out by 0.02 per frame at 60 Hz
+		screen.vignette_intensity -= elapsed_ms_since_last_update * 0.0012f;
+		if (screen.vignette_intensity <= 0.0f)
+			screen.apply_vignette = 0;
 	}
+	if (!screen.apply_vignette)
+		screen.vignette_intensity = 0;
 
     float min_counter_ms = 3000.f;
 	for (Entity entity : registry.deathTimers.entities) {
@@ -301,35 +208,63 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	}
 
 
-	// particle explosion stepping for collisions between tower and invader
-	for (Entity entity: registry.explosions.entities) {
-		Explosion& explosion = registry.explosions.get(entity);
-
-		explosion.timer += elapsed_ms_since_last_update / 1000.0f;
+	return true;
+}
 
-		// update all paticle elements
-		for (auto& particle : explosion.particles) {
-			particle.lifespan -= elapsed_ms_since_last_update / 1000.0f;
-			particle.position += particle.velocity * (elapsed_ms_since_last_update / 1000.0f);
-			particle.color.a = particle.lifespan / 1.0f; // reduce intensity
-		}
+void WorldSystem::step_animations(float elapsed_ms_since_last_update) {
 
-		// remove particles that are passed their lifespan
-		explosion.particles.erase(
-			std::remove_if(explosion.particles.begin(), explosion.particles.end(),
-						[](const Particle& p) { return p.lifespan <= 0; }),
-			explosion.particles.end()
-		);
+	// walking animation
+	for (Entity entity : registry.invaders.entities) {
+		Invader invader = registry.invaders.get(entity);
+		if (registry.animations.has(entity)) {
+			Animation& anim = registry.animations.get(entity);
+			anim.timer += elapsed_ms_since_last_update / 1000.0f;
 
-		// if no particles, explosion should be removed
-		if (explosion.particles.empty() || explosion.timer >= explosion.duration) {
-			registry.remove_all_components_of(entity);
+			if (anim.timer >= anim.frame_duration) {
+				anim.timer = 0.0f;
+    	        anim.current_frame = (anim.current_frame + 1) % anim.total_frames; 
+				RenderRequest& render_request = registry.renderRequests.get(entity);
+				if (invader.type == 0) {
+					if (anim.current_frame == 0) {
+						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_IDLE_BLUE;
+					} else if (anim.current_frame == 1) {
+						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_WALKING_BLUE;
+					} else {
+						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_RUNNING_BLUE;
+					}
+				} else if (invader.type == 1) {
+					if (anim.current_frame == 0) {
+						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_GREEN_ONE;
+					} else if (anim.current_frame == 1) {
+						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_GREEN_TWO;
+					} else {
+						render_request.used_texture = TEXTURE_ASSET_ID::INVADER_GREEN_THREE;
+					}
+				}
+			}
 		}
 	}
+}
 
+void WorldSystem::step_particles(float elapsed_ms_since_last_update) {
 
+	// particles stand still at game over
+	if (game_over)
+		return;
 
-	return true;
+	// on the GPU the renderer moves the particles, the explosions only time out
+	if (particle_pool.simulate_on_gpu)
+		particle_pool.gpu_time_ms += elapsed_ms_since_last_update;
+
+	// particle explosion stepping for collisions between tower and invader
+	// the particle ranges of the explosions don't overlap, they are updated in parallel
+	job_system.parallel_for(registry.explosions, 4, [&](Entity, Explosion& explosion) {
+		explosion.timer += elapsed_ms_since_last_update / 1000.0f;
+
+		// update all paticle elements, particles that are passed their lifespan are removed
+		if (explosion.has_range && !particle_pool.simulate_on_gpu)
+			explosion.count = particle_pool.update(explosion.first, explosion.count, elapsed_ms_since_last_update);
+	});
 }
 
 // Reset the world state to its initial state
@@ -337,47 +272,43 @@ void WorldSystem::restart_game() {
 
 	std::cout << "Restarting..." << std::endl;
 
-	// Debugging for memory/component leaks
-	registry.list_all_components();
-
 	// Reset the game speed
 	current_speed = 1.f;
 
 	points = 0;
 	max_towers = MAX_TOWERS_START;
-	next_invader_spawn = 0;
-	invader_spawn_rate_ms = INVADER_SPAWN_RATE_MS;
+	waves.reset();
 	game_over = false;
-
-	// Remove all entities that we created
-	// All that have a motion, we could also iterate over all bug, eagles, ... but that would be more cumbersome
-	while (registry.motions.entities.size() > 0)
-	    registry.remove_all_components_of(registry.motions.entities.back());
-
-	// debugging for memory/component leaks
-	registry.list_all_components();
+	fast_forward.set_mode(FAST_FORWARD_MODE::OFF);
+
+	// Put back the world as it was after the first start, no matter how many entities the last game left
+	if (!initial_state.empty()) {
+		registry.restore(initial_state);
+		influence_map.clear();
+		particle_pool.clear();
+		return;
+	}
 
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 	// TODO A1: create grid lines
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 	int grid_line_width = GRID_LINE_WIDTH_PX;
 
-	// create grid lines if they do not already exist
-	if (grid_lines.size() == 0) {
-		// vertical lines
-		int cell_width = GRID_CELL_WIDTH_PX;
-		for (int col = 0; col < 14 + 1; col++) {
-			// width of 2 to make the grid easier to see
-			grid_lines.push_back(createGridLine(vec2(col * cell_width, 0), vec2(grid_line_width, 2 * WINDOW_HEIGHT_PX)));
-		}
+	// vertical lines
+	int cell_width = GRID_CELL_WIDTH_PX;
+	for (int col = 0; col < 14 + 1; col++) {
+		// width of 2 to make the grid easier to see
+		grid_lines.push_back(createGridLine(vec2(col * cell_width, 0), vec2(grid_line_width, 2 * WINDOW_HEIGHT_PX)));
+	}
 
-		// horizontal lines
-		int cell_height = GRID_CELL_HEIGHT_PX;
-		for (int col = 0; col < 10 + 1; col++) {
-			// width of 2 to make the grid easier to see
-			grid_lines.push_back(createGridLine(vec2(0, col * cell_height), vec2(2 * WINDOW_WIDTH_PX, grid_line_width)));
-		}
+	// horizontal lines
+	int cell_height = GRID_CELL_HEIGHT_PX;
+	for (int col = 0; col < 10 + 1; col++) {
+		// width of 2 to make the grid easier to see
+		grid_lines.push_back(createGridLine(vec2(0, col * cell_height), vec2(2 * WINDOW_WIDTH_PX, grid_line_width)));
 	}
+
+	initial_state = registry.snapshot();
 }
 
 // Compute collisions between entities
@@ -386,67 +317,160 @@ void WorldSystem::handle_collisions() {
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 	// TODO A1: Loop over all collisions detected by the physics system
 	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-	ComponentContainer<Collision>& collision_container = registry.collisions;
-	for (uint i = 0; i < collision_container.components.size(); i++) {
-		
-		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-		// TODO A1: handle collision between deadly (projectile) and invader
-		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-		// Mix_PlayChannel(-1, chicken_dead_sound, 0);
+	// a pair is reported once, either of the two may be the invader
+	collision_events.read(collision_reader, [this](const CollisionEvent& collision) {
+		handle_collision(collision.first, collision.second);
+		handle_collision(collision.second, collision.first);
+	});
+
+	// the damage of this step is applied in handle_damage
+	damage_events.publish();
+}
 
-		Entity invader = collision_container.entities[i];
-		Entity other = collision_container.components[i].other;
+void WorldSystem::handle_collision(Entity invader, Entity other) {
 
-		if (registry.invaders.has(invader) && registry.projectiles.has(other)) {
-			Invader& inv = registry.invaders.get(invader);
-			Motion& invader_motion = registry.motions.get(invader);
-			inv.health -= PROJECTILE_DAMAGE;
+	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	// TODO A1: handle collision between deadly (projectile) and invader
+	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	if (registry.invaders.has(invader) && registry.projectiles.has(other)) {
+		damage_events.push({ invader, PROJECTILE_DAMAGE });
+		destroyProjectile(other);
+	}
+
+	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	// TODO A1: handle collision between tower and invader
+	// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+	// audio.play(SOUND_ASSET_ID::CHICKEN_EAT);
 
-			registry.remove_all_components_of(other);
+	if (registry.invaders.has(invader) && registry.towers.has(other)) {
+		Motion& tower_motion = registry.motions.get(other);
+		createExplosion(tower_motion.position, vec4(0.0f, 1.0f, 0.4f, 1.0f), 20);
 
-			if (inv.health <= 0) {
-				createExplosion(invader_motion.position, vec4(0.8f, 0.1f, 1.0f, 1.0f), 20); 
+		destroyInvader(invader);
+		destroyTower(other);
+		audio.play(SOUND_ASSET_ID::CHICKEN_EAT);
 
-				registry.remove_all_components_of(invader);
-				Mix_PlayChannel(-1, chicken_dead_sound, 0);
-				
-				points++;
-			}
+		if (max_towers > 0) {
+			max_towers--;
+			std::cout << "Tower destroyed! Max towers reduced to: " << max_towers << std::endl;
 		}
 
+		ScreenState& screen = registry.screenStates.components[0];
+		screen.apply_vignette = 1;  
+		screen.vignette_intensity = 1.0f; 
+	}
+}
 
-		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-		// TODO A1: handle collision between tower and invader
-		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-		// Mix_PlayChannel(-1, chicken_eat_sound, 0);
+// Apply the damage dealt in this step
+void WorldSystem::handle_damage() {
 
-		if (registry.invaders.has(invader) && registry.towers.has(other)) {
-			Motion& tower_motion = registry.motions.get(other);
-			createExplosion(tower_motion.position, vec4(0.0f, 1.0f, 0.4f, 1.0f), 20);
+	damage_events.read(damage_reader, [this](const DamageEvent& damage) {
+		// e.g., killed by an earlier hit, or by running into a tower
+		if (!registry.invaders.has(damage.target))
+			return;
 
-			registry.remove_all_components_of(invader);
-			registry.remove_all_components_of(other);
-			Mix_PlayChannel(-1, chicken_eat_sound, 0);
+		Invader& inv = registry.invaders.get(damage.target);
+		inv.health -= damage.amount;
+		if (inv.health <= 0) {
+			Motion& invader_motion = registry.motions.get(damage.target);
+			createExplosion(invader_motion.position, vec4(0.8f, 0.1f, 1.0f, 1.0f), 20); 
 
-			if (max_towers > 0) {
-                max_towers--;
-                std::cout << "Tower destroyed! Max towers reduced to: " << max_towers << std::endl;
-			}
+			destroyInvader(damage.target);
+			audio.play(SOUND_ASSET_ID::CHICKEN_DEAD);
+			
+			points++;
+		}
+	});
+}
+
+void WorldSystem::fast_forward_until_wave_end() {
+	fast_forward.set_mode(FAST_FORWARD_MODE::UNTIL_WAVE_END);
+	fast_forward_wave = waves.get_wave();
+}
 
-			ScreenState& screen = registry.screenStates.components[0];
-			screen.apply_vignette = 1;  
-			screen.vignette_intensity = 1.0f; 
+bool WorldSystem::record_input(const std::string& path) {
+	return recorder.start(path, seed);
+}
+
+bool WorldSystem::replay_input(const std::string& path) {
+	if (!replay.load(path))
+		return false;
+	seed = replay.get_seed();
+	replay_ticks = 0;
+	return true;
+}
+
+bool WorldSystem::next_replay_tick(float& elapsed_ms) {
+	InputEvent event;
+	while (replay.next(event)) {
+		switch (event.type) {
+		case INPUT_RECORD::KEY:
+			on_key(event.key, 0, event.action, event.mods);
+			break;
+		case INPUT_RECORD::MOUSE_MOVE:
+			on_mouse_move(event.position);
+			break;
+		case INPUT_RECORD::MOUSE_BUTTON:
+			on_mouse_button_pressed(event.key, event.action, event.mods);
+			break;
+		case INPUT_RECORD::TICK:
+			elapsed_ms = event.elapsed_ms;
+			replay_ticks++;
+			return true;
+		case INPUT_RECORD::END:
+			if (event.ticks == replay_ticks && event.state_hash == state_hash())
+				printf("Replay of %u ticks matches the recording\n", replay_ticks);
+			else
+				fprintf(stderr, "Replay diverged from the recording after %u ticks\n", replay_ticks);
+			return false;
 		}
+	}
+	fprintf(stderr, "Input recording ended unexpectedly after %u ticks\n", replay_ticks);
+	return false;
+}
+
+uint64_t WorldSystem::state_hash() const {
+	// FNV-1a over the points and everything that moves
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const void* data, size_t size) {
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ ((const uint8_t*)data)[i]) * 1099511628211ull;
+	};
+	add(&points, sizeof(points));
+	// entity ids are left out, the game and the headless build create different helper entities
+	for (const Motion& motion : registry.motions.components) {
+		add(&motion.position, sizeof(motion.position));
+		add(&motion.velocity, sizeof(motion.velocity));
+	}
+	for (const Invader& invader : registry.invaders.components)
+		add(&invader.health, sizeof(invader.health));
+	return hash;
+}
 
+void WorldSystem::input_key(int key, int scancode, int action, int mod) {
+	// quitting is not part of the recording
+	if (key == GLFW_KEY_ESCAPE) {
+		on_key(key, scancode, action, mod);
+		return;
 	}
+	if (is_replaying())
+		return;
+	recorder.key(key, action, mod);
+	on_key(key, scancode, action, mod);
+}
 
-	// Remove all collisions from this simulation step
-	registry.collisions.clear();
+void WorldSystem::input_mouse_move(vec2 mouse_position) {
+	if (is_replaying())
+		return;
+	recorder.mouse_move(mouse_position);
+	on_mouse_move(mouse_position);
 }
 
-// Should the game be over ?
-bool WorldSystem::is_over() const {
-	return bool(glfwWindowShouldClose(window));
+void WorldSystem::input_mouse_button(int button, int action, int mods) {
+	if (is_replaying())
+		return;
+	recorder.mouse_button(button, action, mods);
+	on_mouse_button_pressed(button, action, mods);
 }
 
 // on key callback
@@ -459,12 +483,17 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 
 	// Resetting game
 	if (action == GLFW_RELEASE && key == GLFW_KEY_R) {
-		int w, h;
-		glfwGetWindowSize(window, &w, &h);
-
         restart_game();
 	}
 
+	// Fast-forward
+	if (action == GLFW_RELEASE && key == GLFW_KEY_F && !game_over) {
+		fast_forward.set_mode(fast_forward.is_on() ? FAST_FORWARD_MODE::OFF : FAST_FORWARD_MODE::SPEED);
+	}
+	if (action == GLFW_RELEASE && key == GLFW_KEY_N && !game_over) {
+		fast_forward_until_wave_end();
+	}
+
 	// Debugging - not used in A1, but left intact for the debug lines
 	if (key == GLFW_KEY_D) {
 		if (action == GLFW_RELEASE) {
@@ -505,14 +534,9 @@ void WorldSystem::on_mouse_button_pressed(int button, int action, int mods) {
 		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
 		if (tile_x == 0 && tile_y > 0) {
-			Entity invader = createInvader(renderer, vec2(tile_x * GRID_CELL_WIDTH_PX + GRID_CELL_WIDTH_PX / 2, tile_y * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2), 
-			(rand() % 2));
 			// Clicking will only be random as well
-			Animation& animation = registry.animations.emplace(invader);
-			animation.frame_duration = 0.3f;
-			animation.is_walking = true;
-			animation.current_frame = 0;
-			animation.total_frames = 3; 
+			createInvader(vec2(tile_x * GRID_CELL_WIDTH_PX + GRID_CELL_WIDTH_PX / 2, tile_y * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2), 
+			random_service.stream(tile_y, RNG_PURPOSE::INVADER_TYPE).next_int(2));
 		}
 
 
@@ -524,7 +548,7 @@ void WorldSystem::on_mouse_button_pressed(int button, int action, int mods) {
 						tile_x * GRID_CELL_WIDTH_PX + GRID_CELL_WIDTH_PX / 2,
 						tile_y * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2
 					));
-					createTower(renderer, vec2(
+					createTower(vec2(
 						tile_x * GRID_CELL_WIDTH_PX + GRID_CELL_WIDTH_PX / 2,
 						tile_y * GRID_CELL_HEIGHT_PX + GRID_CELL_HEIGHT_PX / 2
 					));
@@ -553,30 +577,3 @@ void WorldSystem::on_mouse_button_pressed(int button, int action, int mods) {
 
 	}
 }
-
-
-// function to create explosion after collision. using particles
-void WorldSystem::createExplosion(const vec2& position, const vec4& color, int num_particles = 20) {
-	Entity explosion_entity = Entity();
-	Explosion& explosion = registry.explosions.emplace(explosion_entity);
-
-	Explosion exp;
-	exp.duration = 1.0f;
-	exp.timer = 0.0f;
-
-	// initialize particles in the explosion
-	for (int i = 0; i < num_particles; ++i) {
-		Particle particle;
-		float angle = ((float)rand() / RAND_MAX) * 2 * M_PI;
-		float speed = ((float)rand() / RAND_MAX) * 100.0f + 50.0f;
-
-		particle.velocity = {cos(angle)*speed, sin(angle)* speed};
-		particle.lifespan = 1.0f;
-		particle.rotation_speed = ((float)rand() / RAND_MAX) * 4.0f - 2.0f;
-		particle.color = color;
-		particle.position = position;
-		explosion.particles.push_back(particle);
-
-	}
-
-}
\ No newline at end of file
@@ -5,16 +5,17 @@
 
 // stlib
 #include <vector>
-#include <random>
 
-#define SDL_MAIN_HANDLED
-#include <SDL.h>
-#include <SDL_mixer.h>
-
-#include "render_system.hpp"
+#include "audio_system.hpp"
+#include "wave_scheduler.hpp"
+#include "input_recorder.hpp"
+#include "fast_forward.hpp"
+#include "events.hpp"
+#include "tinyECS/registry.hpp"
 
 // Container for all our entities and game logic.
 // Individual rendering / updates are deferred to the update() methods.
+// The window is handled in world_system_window.cpp, headless builds use world_system_headless.cpp instead.
 class WorldSystem
 {
 public:
@@ -30,43 +31,76 @@ public:
 	void close_window();
 
 	// starts the game
-	void init(RenderSystem* renderer);
+	void init();
 
 	// releases all associated resources
 	~WorldSystem();
 
 	// steps the game ahead by ms milliseconds
 	bool step(float elapsed_ms);
+	// invader walking animation, and the particles of explosions; they don't add or remove entities
+	void step_animations(float elapsed_ms);
+	void step_particles(float elapsed_ms);
 
-	// check for collisions generated by the physics system
+	// handles the collisions reported by the physics system
 	void handle_collisions();
+	// applies the damage dealt by the collisions
+	void handle_damage();
 
 	// should the game be over ?
 	bool is_over() const;
 
 	bool game_over = false;
 
-	void createExplosion(const vec2& position, const vec4& color, int num_particles);
+	unsigned int get_points() const { return points; }
+
+	// F toggles fast-forward, N fast-forwards until the next wave
+	FastForward& get_fast_forward() { return fast_forward; }
+	void fast_forward_until_wave_end();
+	const WaveScheduler& get_waves() const { return waves; }
 
+	// Input recording and replay (see input_recorder.hpp), call before init() since the recording
+	// holds the RNG seed. Live input is ignored while replaying, except for closing the window.
+	bool record_input(const std::string& path);
+	bool replay_input(const std::string& path);
+	bool is_replaying() const { return replay.is_loaded(); }
+	// handles the recorded input of the next tick and sets its elapsed time, returns false once the replay ended
+	bool next_replay_tick(float& elapsed_ms);
 
 private:
 
 	float mouse_pos_x = 0.0f;
 	float mouse_pos_y = 0.0f;
 
+	// live input from the window, recorded and passed on to the callbacks below
+	void input_key(int key, int scancode, int action, int mod);
+	void input_mouse_move(vec2 pos);
+	void input_mouse_button(int button, int action, int mods);
+
 	// input callback functions
 	void on_key(int key, int, int action, int mod);
 	void on_mouse_move(vec2 pos);
 	void on_mouse_button_pressed(int button, int action, int mods);
 
+	// hash over the simulation state, to check a replay against its recording
+	uint64_t state_hash() const;
+
 	// restart level
 	void restart_game();
 
-	// OpenGL window handle
-	GLFWwindow* window;
+	void handle_collision(Entity invader, Entity other);
+
+	// shows the points in the window title
+	void update_window_title();
+	void destroy_window();
 
-	int next_invader_spawn;
-	int invader_spawn_rate_ms;	// see default value in common.hpp
+	// OpenGL window handle, stays null in headless builds
+	GLFWwindow* window = nullptr;
+	bool should_close = false;
+
+	// invader spawns, see data/waves
+	WaveScheduler waves;
+	const std::string wave_file = wave_path("waves.txt");
 
 	int max_towers;	// see default value in common.hpp
 
@@ -74,18 +108,27 @@ private:
 	unsigned int points;
 
 	// Game state
-	RenderSystem* renderer;
 	float current_speed;
 
 	// grid
 	std::vector<Entity> grid_lines;
 
-	// music references
-	Mix_Music* background_music;
-	Mix_Chunk* chicken_dead_sound;
-	Mix_Chunk* chicken_eat_sound;
+	EventQueue<CollisionEvent>::Reader collision_reader;
+	EventQueue<DamageEvent>::Reader damage_reader;
+
+	FastForward fast_forward;
+	int fast_forward_wave = 0;		// wave in which UNTIL_WAVE_END was started
+	std::string window_title;
+
+	// the world after the first start, restarts restore it
+	RegistrySnapshot initial_state;
+
+	// music and sound effects
+	AudioSystem audio;
 
-	// C++ random number generator
-	std::default_random_engine rng;
-	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
+	// seed of the random_service, random unless replaying a recording
+	unsigned int seed;
+	InputRecorder recorder;
+	InputReplay replay;
+	unsigned int replay_ticks = 0;
 };
@@ -0,0 +1,22 @@
+// Header
+#include "world_system.hpp"
+
+// Window handling for headless builds: there is no window, the simulation runs until close_window() is called
+
+GLFWwindow* WorldSystem::create_window() {
+	return nullptr;
+}
+
+void WorldSystem::close_window() {
+	should_close = true;
+}
+
+void WorldSystem::destroy_window() {
+}
+
+void WorldSystem::update_window_title() {
+}
+
+bool WorldSystem::is_over() const {
+	return should_close;
+}
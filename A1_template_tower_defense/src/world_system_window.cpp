@@ -0,0 +1,93 @@
+// Header
+#include "world_system.hpp"
+
+// stlib
+#include <sstream>
+#include <iostream>
+
+// Debugging
+namespace {
+	void glfw_err_cb(int error, const char *desc) {
+		std::cerr << error << ": " << desc << std::endl;
+	}
+}
+
+// call to close the window, wrapper around GLFW commands
+void WorldSystem::close_window() {
+	glfwSetWindowShouldClose(window, GLFW_TRUE);
+}
+
+// World initialization
+// Note, this has a lot of OpenGL specific things, could be moved to the renderer
+GLFWwindow* WorldSystem::create_window() {
+
+	///////////////////////////////////////
+	// Initialize GLFW
+	glfwSetErrorCallback(glfw_err_cb);
+	if (!glfwInit()) {
+		std::cerr << "ERROR: Failed to initialize GLFW in world_system.cpp" << std::endl;
+		return nullptr;
+	}
+
+	//-------------------------------------------------------------------------
+	// If you are on Linux or Windows, you can change these 2 numbers to 4 and 3 and
+	// enable the glDebugMessageCallback to have OpenGL catch your mistakes for you.
+	// GLFW / OGL Initialization
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#if __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+	glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+	// CK: setting GLFW_SCALE_TO_MONITOR to true will rescale window but then you must handle different scalings
+	// glfwWindowHint(GLFW_SCALE_TO_MONITOR, GL_TRUE);		// GLFW 3.3+
+	glfwWindowHint(GLFW_SCALE_TO_MONITOR, GL_FALSE);		// GLFW 3.3+
+
+	// Create the main window (for rendering, keyboard, and mouse input)
+	window = glfwCreateWindow(WINDOW_WIDTH_PX, WINDOW_HEIGHT_PX, "Towers vs Invaders Assignment", nullptr, nullptr);
+	if (window == nullptr) {
+		std::cerr << "ERROR: Failed to glfwCreateWindow in world_system.cpp" << std::endl;
+		return nullptr;
+	}
+
+	// Setting callbacks to member functions (that's why the redirect is needed)
+	// Input is handled using GLFW, for more info see
+	// http://www.glfw.org/docs/latest/input_guide.html
+	glfwSetWindowUserPointer(window, this);
+	auto key_redirect = [](GLFWwindow* wnd, int _0, int _1, int _2, int _3) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->input_key(_0, _1, _2, _3); };
+	auto cursor_pos_redirect = [](GLFWwindow* wnd, double _0, double _1) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->input_mouse_move({ _0, _1 }); };
+	auto mouse_button_pressed_redirect = [](GLFWwindow* wnd, int _button, int _action, int _mods) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->input_mouse_button(_button, _action, _mods); };
+	
+	glfwSetKeyCallback(window, key_redirect);
+	glfwSetCursorPosCallback(window, cursor_pos_redirect);
+	glfwSetMouseButtonCallback(window, mouse_button_pressed_redirect);
+
+	return window;
+}
+
+void WorldSystem::destroy_window() {
+	if (window != nullptr)
+		glfwDestroyWindow(window);
+}
+
+void WorldSystem::update_window_title() {
+	std::stringstream title_ss;
+	title_ss << "Points: " << points;
+	if (fast_forward.get_mode() == FAST_FORWARD_MODE::SPEED)
+		title_ss << "  >> x" << FAST_FORWARD_SPEED;
+	else if (fast_forward.get_mode() == FAST_FORWARD_MODE::UNTIL_WAVE_END)
+		title_ss << "  >> wave " << waves.get_wave() + 2;
+
+	// called every tick, which are many per frame while fast-forwarding
+	if (title_ss.str() == window_title)
+		return;
+	window_title = title_ss.str();
+	glfwSetWindowTitle(window, window_title.c_str());
+}
+
+// Should the game be over ?
+bool WorldSystem::is_over() const {
+	return bool(glfwWindowShouldClose(window));
+}